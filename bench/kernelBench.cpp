@@ -0,0 +1,296 @@
+/**
+ * Nanoseconds per agent of the array store kernels and of the coalition
+ * payoff split, without Repast HPC or MPI.
+ *
+ * usage: kernelBench [side] [neighborhood] [strategies] [coalitions]
+ *                    [trials]
+ *
+ * Lays out a side x side torus tile (256) with the von Neumann (0) or
+ * Moore (1, default) neighborhood, strategies drawn with the pTFT:TFT:Random
+ * weights (1:1:1) and about the given share of the agents in coalitions
+ * (0.5). Members join a neighboring leader, so a coalition has up to 8
+ * members (4 with von Neumann). Every trial runs a kernel once on a fresh
+ * copy of the tile; the min, median, mean and standard deviation over the
+ * trials are reported.
+ * OMP_NUM_THREADS sets the threads of the kernels.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "agentConstants.h"
+#include "agentStore.h"
+#include "cellRandom.h"
+#include "coalitionSplit.h"
+#include "payoffPlanes.h"
+
+const int PAYOFF_T = 5;
+const int PAYOFF_R = 3;
+const int PAYOFF_P = 1;
+const int PAYOFF_S = 0;
+const float TAX = 0.1;
+
+// Streams of the tile layout, after the model's
+const int STREAM_BENCH_STRATEGY = 5;
+const int STREAM_BENCH_LEADER = 6;
+const int STREAM_BENCH_PAYOFF = 7;
+
+const int KERNEL_DECIDE_ACTION = 0;
+const int KERNEL_PAYOFF = 1;
+const int KERNEL_PAYOFF_PLANES = 2;
+const int KERNEL_DECIDE_COALITION = 3;
+const int KERNEL_COALITION_PAYOFF = 4;
+const int NUM_KERNELS = 5;
+
+const char* KERNEL_NAMES[NUM_KERNELS] = { "decideAction", "calculatePayoff",
+		"calculatePayoffPlanes", "decideCoalition",
+		"calculateCoalitionPayoff" };
+
+// Contributions (member cell, payoff) of every leader's members
+typedef std::vector<std::vector<std::pair<int, double> > > Contributions;
+
+/**
+ * Store slot of the tile cell at (x, y), wrapped around the torus
+ */
+int slotOf(int _side, int _x, int _y) {
+	return (((_y + _side) % _side) * _side) + ((_x + _side) % _side);
+}
+
+void buildTile(int _side, bool _moore, const double* _weights,
+		double _coalitions, const CellRandom& _random, AgentStore& _store,
+		std::vector<int>& _frame, Contributions& _contributions) {
+	int cells = _side * _side;
+	_store.resize(cells, 0);
+	_store.deltaTrust = 0.05;
+	_store.trustThreshold = 0.25;
+
+	double totalWeight = _weights[PTFT] + _weights[TFT] + _weights[RANDOM];
+	for (int i = 0; i < cells; i++) {
+		_store.id[i] = i;
+		_store.cell[i] = i;
+		_store.leader[i] = i;
+
+		double u = _random.uniform(i, 0, STREAM_BENCH_STRATEGY, 0)
+				* totalWeight;
+		if (u < _weights[PTFT]) {
+			_store.strategy[i] = PTFT;
+		} else if (u < _weights[PTFT] + _weights[TFT]) {
+			_store.strategy[i] = TFT;
+		} else {
+			_store.strategy[i] = RANDOM;
+		}
+
+		_store.considerTrust[i] = _random.next(STREAM_CONSIDER_TRUST, i)
+				<= 0.25;
+		_store.trustLeader[i] = _random.next(STREAM_TRUST_LEADER, i);
+		_store.action[i] = (int) _random.next(STREAM_ACTION, i);
+		_store.payoff[i] = _random.uniform(i, 0, STREAM_BENCH_PAYOFF, 0)
+				* PAYOFF_T * 8;
+	}
+
+	// Neighbors in the model's order
+	int dx[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+	int dy[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+	for (int i = 0; i < cells; i++) {
+		int x = i % _side;
+		int y = i / _side;
+		for (int n = 0; n < 8; n++) {
+			if ((_moore) || (dx[n] == 0) || (dy[n] == 0)) {
+				_store.neighbors.push_back(slotOf(_side, x + dx[n], y + dy[n]));
+			}
+		}
+		_store.neighborBegin[i + 1] = _store.neighbors.size();
+	}
+
+	// Leaders first, then every independent next to one joins it. The share
+	// of leaders is the one expected to put the share of coalitions in them.
+	int size = _moore ? 8 : 4;
+	double low = 0;
+	double high = _coalitions;
+	for (int step = 0; step < 50; step++) {
+		double leaders = (low + high) / 2;
+		double joined = leaders
+				+ ((1 - leaders) * (1 - std::pow(1 - leaders, size)));
+		if (joined < _coalitions) {
+			low = leaders;
+		} else {
+			high = leaders;
+		}
+	}
+	for (int i = 0; i < cells; i++) {
+		if (_random.uniform(i, 0, STREAM_BENCH_LEADER, 0) < low) {
+			_store.status[i] = STATUS_LEADER;
+		}
+	}
+	_contributions.assign(cells, std::vector<std::pair<int, double> >());
+	for (int i = 0; i < cells; i++) {
+		if (_store.status[i] != STATUS_INDEPENDENT) {
+			continue;
+		}
+
+		for (int k = _store.neighborBegin[i]; k < _store.neighborBegin[i + 1];
+				k++) {
+			int n = _store.neighbors[k];
+			if (_store.status[n] == STATUS_LEADER) {
+				_store.status[i] = STATUS_MEMBER;
+				_store.leader[i] = _store.id[n];
+				_contributions[n].push_back(
+						std::make_pair((int) _store.cell[i],
+								_store.payoff[i]));
+				break;
+			}
+		}
+	}
+
+	// Frame of the tile and its ghost ring, wrapped onto the tile
+	int frameSide = _side + 2;
+	_frame.assign(frameSide * frameSide, -1);
+	for (int r = 0; r < frameSide; r++) {
+		for (int c = 0; c < frameSide; c++) {
+			bool corner = ((r == 0) || (r == frameSide - 1))
+					&& ((c == 0) || (c == frameSide - 1));
+			if ((_moore) || (!corner)) {
+				_frame[(r * frameSide) + c] = slotOf(_side, c - 1, r - 1);
+			}
+		}
+	}
+}
+
+double runKernel(int _kernel, const AgentStore& _tile,
+		const Contributions& _contributions, PayoffPlanes& _planes,
+		CellRandom& _random, int _round) {
+	AgentStore store = _tile;
+	Contributions contributions;
+	std::vector<double> shares;
+	if (_kernel == KERNEL_COALITION_PAYOFF) {
+		contributions = _contributions;
+		shares.resize(store.numLocal);
+	}
+	_random.setRound(_round);
+
+	std::chrono::steady_clock::time_point start =
+			std::chrono::steady_clock::now();
+	switch (_kernel) {
+	case KERNEL_DECIDE_ACTION:
+		store.decideAction(_random);
+		break;
+	case KERNEL_PAYOFF:
+		store.calculatePayoff(PAYOFF_T, PAYOFF_R, PAYOFF_P, PAYOFF_S);
+		break;
+	case KERNEL_PAYOFF_PLANES:
+		_planes.calculatePayoff(store, PAYOFF_T, PAYOFF_R, PAYOFF_P,
+				PAYOFF_S);
+		break;
+	case KERNEL_DECIDE_COALITION:
+		store.decideCoalition(_random);
+		break;
+	case KERNEL_COALITION_PAYOFF:
+		// As the model's leaders, contributions sorted by member cell
+#pragma omp parallel for schedule(dynamic, 64)
+		for (int i = 0; i < store.numLocal; i++) {
+			if (store.status[i] == STATUS_LEADER) {
+				std::vector<std::pair<int, double> >& payoffs =
+						contributions[i];
+				std::sort(payoffs.begin(), payoffs.end());
+				shares[i] = splitCoalitionPayoff(0, payoffs, payoffs.size(),
+						TAX, store.payoff[i]);
+			}
+		}
+		break;
+	}
+	std::chrono::steady_clock::time_point end =
+			std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+int main(int argc, char* argv[]) {
+	int side = (argc > 1) ? std::atoi(argv[1]) : 256;
+	bool moore = (argc > 2) ? std::atoi(argv[2]) == 1 : true;
+	std::string mix = (argc > 3) ? argv[3] : "1:1:1";
+	double coalitions = (argc > 4) ? std::atof(argv[4]) : 0.5;
+	int trials = (argc > 5) ? std::atoi(argv[5]) : 50;
+
+	double weights[3] = { 1, 1, 1 };
+	std::istringstream weightStream(mix);
+	std::string weight;
+	for (int s = 0; (s < 3) && (std::getline(weightStream, weight, ':'));
+			s++) {
+		weights[s] = std::atof(weight.c_str());
+	}
+
+	if ((side < 2) || (trials < 1)) {
+		std::cerr << "usage: kernelBench [side] [neighborhood] [strategies] "
+				<< "[coalitions] [trials]" << std::endl;
+		return 1;
+	}
+
+	// Distributions of conf/model.props
+	CellRandom random;
+	random.seed(1);
+	random.setDistribution(STREAM_CONSIDER_TRUST,
+			CellDistribution::parse("double_uniform, 0, 1"));
+	random.setDistribution(STREAM_DECISION_ACTION,
+			CellDistribution::parse("double_uniform, 0, 1"));
+	random.setDistribution(STREAM_ACTION,
+			CellDistribution::parse("int_uniform, 0, 1"));
+	random.setDistribution(STREAM_TRUST_LEADER,
+			CellDistribution::parse("double_uniform, 0, 1"));
+
+	AgentStore tile;
+	std::vector<int> frame;
+	Contributions contributions;
+	buildTile(side, moore, weights, coalitions, random, tile, frame,
+			contributions);
+
+	PayoffPlanes planes;
+	planes.build(side, side, moore, frame);
+
+	int threads = 1;
+#ifdef _OPENMP
+	threads = omp_get_max_threads();
+#endif
+
+	int cells = side * side;
+	std::cout << "kernel;agents;neighborhood;threads;trials;min_ns;"
+			<< "median_ns;mean_ns;stddev_ns" << std::endl;
+	for (int k = 0; k < NUM_KERNELS; k++) {
+		// Warm up the caches and the threads
+		runKernel(k, tile, contributions, planes, random, 0);
+
+		std::vector<double> perAgent(trials);
+		for (int t = 0; t < trials; t++) {
+			perAgent[t] = runKernel(k, tile, contributions, planes, random,
+					t + 1) / cells;
+		}
+
+		std::sort(perAgent.begin(), perAgent.end());
+		double sum = 0;
+		for (int t = 0; t < trials; t++) {
+			sum += perAgent[t];
+		}
+		double mean = sum / trials;
+		double squares = 0;
+		for (int t = 0; t < trials; t++) {
+			squares += (perAgent[t] - mean) * (perAgent[t] - mean);
+		}
+		double median = (trials % 2 == 1) ? perAgent[trials / 2] :
+				(perAgent[trials / 2 - 1] + perAgent[trials / 2]) / 2;
+
+		std::cout << KERNEL_NAMES[k] << ";" << cells << ";"
+				<< (moore ? "moore" : "vonNeumann") << ";" << threads << ";"
+				<< trials << ";" << perAgent[0] << ";" << median << ";"
+				<< mean << ";" << std::sqrt(squares / trials) << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * Bytes and pack/unpack time per round of the agent package wire format.
+ *
+ * usage: packageBench [agents per round] [rounds]
+ *
+ * Compares the former field by field Boost.Serialization package, with all
+ * fields and with only the payoff changed, against the fixed layout
+ * LandAgentPackage shipped as an MPI datatype.
+ */
+#include <iostream>
+#include <vector>
+
+#include <boost/mpi.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "landAgent.h"
+
+// Package as serialized before the fixed layout
+struct LegacyPackage {
+
+	template<class Archive>
+	void serialize(Archive & ar, const unsigned int version) {
+		ar & id;
+		ar & proc;
+		ar & type;
+		ar & fields;
+		if (fields & DIRTY_POSITION) {
+			ar & x;
+			ar & y;
+		}
+		if (fields & DIRTY_STATUS) {
+			ar & isIndependent;
+			ar & isMember;
+			ar & isLeader;
+		}
+		if (fields & DIRTY_LEADER) {
+			ar & leaderId;
+			ar & leaderProc;
+			ar & leaderType;
+		}
+		if (fields & DIRTY_ACTION) {
+			ar & action;
+		}
+		if (fields & DIRTY_PAYOFF) {
+			ar & payoff;
+		}
+		if (fields & DIRTY_COALITION_PAYOFF) {
+			ar & coalitionPayoff;
+		}
+	}
+
+	int id;
+	int proc;
+	int type;
+	int x;
+	int y;
+	bool isIndependent;
+	bool isMember;
+	bool isLeader;
+	int leaderId;
+	int leaderProc;
+	int leaderType;
+	int action;
+	double payoff;
+	double coalitionPayoff;
+	int fields;
+};
+
+template<typename Package>
+void fill(std::vector<Package>& _packages, int _fields) {
+	for (int i = 0, size = _packages.size(); i < size; i++) {
+		Package& package = _packages[i];
+		package.id = i;
+		package.proc = 0;
+		package.type = 0;
+		package.x = i % 1024;
+		package.y = i / 1024;
+		package.isIndependent = (i % 3) == 0;
+		package.isMember = (i % 3) == 1;
+		package.isLeader = (i % 3) == 2;
+		package.leaderId = i / 4;
+		package.leaderProc = 0;
+		package.leaderType = 0;
+		package.action = i % 2;
+		package.payoff = i * 0.25;
+		package.coalitionPayoff = i * 0.5;
+		package.fields = _fields;
+	}
+}
+
+template<typename Package>
+void run(const std::string& _name, boost::mpi::communicator& _world,
+		int _agents, int _rounds, int _fields) {
+	std::vector<Package> packages(_agents);
+	std::vector<Package> received;
+	fill(packages, _fields);
+
+	double packTime = 0;
+	double unpackTime = 0;
+	std::size_t bytes = 0;
+
+	for (int r = 0; r < _rounds; r++) {
+		boost::mpi::packed_oarchive out(_world);
+
+		double start = MPI_Wtime();
+		out << packages;
+		packTime += MPI_Wtime() - start;
+		bytes = out.size();
+
+		boost::mpi::packed_iarchive in(_world);
+		in.resize(out.size());
+		std::copy(static_cast<const char*>(out.address()),
+				static_cast<const char*>(out.address()) + out.size(),
+				static_cast<char*>(in.address()));
+
+		start = MPI_Wtime();
+		in >> received;
+		unpackTime += MPI_Wtime() - start;
+	}
+
+	std::cout << _name << ";" << _agents << ";" << bytes << ";"
+			<< (packTime / _rounds) * 1e6 << ";"
+			<< (unpackTime / _rounds) * 1e6 << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	boost::mpi::environment env(argc, argv);
+	boost::mpi::communicator world;
+
+	int agents = (argc > 1) ? boost::lexical_cast<int>(argv[1]) : 100000;
+	int rounds = (argc > 2) ? boost::lexical_cast<int>(argv[2]) : 20;
+
+	if (world.rank() == 0) {
+		std::cout << "format;agents;bytes;pack_us;unpack_us" << std::endl;
+		run<LegacyPackage>("legacy", world, agents, rounds, DIRTY_ALL);
+		run<LegacyPackage>("legacy-payoff", world, agents, rounds,
+				DIRTY_PAYOFF);
+		run<LandAgentPackage>("fixed", world, agents, rounds, DIRTY_ALL);
+	}
+
+	return 0;
+}
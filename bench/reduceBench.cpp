@@ -0,0 +1,107 @@
+/**
+ * Time per recorded tick of the output reductions.
+ *
+ * usage: mpirun -np <processes> reduceBench [ticks] [flush]
+ *
+ * Compares one reduction per field and tick (the former per data source
+ * reductions, 10 int and 2 double fields), one packed reduction per tick
+ * and one packed reduction per flush window of ticks. Times are the
+ * slowest process, so they include the wait for the others.
+ */
+#include <iostream>
+#include <vector>
+
+#include <boost/mpi.hpp>
+#include <boost/lexical_cast.hpp>
+
+const int INT_FIELDS = 10;
+const int DOUBLE_FIELDS = 2;
+const int FIELDS = INT_FIELDS + DOUBLE_FIELDS;
+
+double separate(boost::mpi::communicator& _world, int _ticks) {
+	int ints[INT_FIELDS];
+	double doubles[DOUBLE_FIELDS];
+	int intSum = 0;
+	double doubleSum = 0;
+
+	for (int f = 0; f < INT_FIELDS; f++) {
+		ints[f] = _world.rank() + f;
+	}
+	for (int f = 0; f < DOUBLE_FIELDS; f++) {
+		doubles[f] = _world.rank() * 0.5 + f;
+	}
+
+	_world.barrier();
+	double start = MPI_Wtime();
+	for (int t = 0; t < _ticks; t++) {
+		for (int f = 0; f < INT_FIELDS; f++) {
+			boost::mpi::reduce(_world, ints[f], intSum, std::plus<int>(), 0);
+		}
+		for (int f = 0; f < DOUBLE_FIELDS; f++) {
+			boost::mpi::reduce(_world, doubles[f], doubleSum,
+					std::plus<double>(), 0);
+		}
+	}
+	return MPI_Wtime() - start;
+}
+
+double packed(boost::mpi::communicator& _world, int _ticks, int _flush) {
+	std::vector<double> records(FIELDS * _flush);
+	std::vector<double> sums(records.size());
+
+	for (int v = 0, size = records.size(); v < size; v++) {
+		records[v] = _world.rank() + v;
+	}
+
+	_world.barrier();
+	double start = MPI_Wtime();
+	for (int t = 0; t < _ticks; t += _flush) {
+		boost::mpi::reduce(_world, &records[0], records.size(), &sums[0],
+				std::plus<double>(), 0);
+	}
+	return MPI_Wtime() - start;
+}
+
+void report(boost::mpi::communicator& _world, const std::string& _mode,
+		int _ticks, int _flush, double _time, double _baseline) {
+	double slowest = 0;
+	boost::mpi::reduce(_world, _time, slowest, boost::mpi::maximum<double>(),
+			0);
+
+	if (_world.rank() == 0) {
+		double perTick = (slowest / _ticks) * 1e6;
+		std::cout << _mode << ";" << _world.size() << ";" << _ticks << ";"
+				<< _flush << ";" << perTick << ";"
+				<< (_baseline - perTick) << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	boost::mpi::environment env(argc, argv);
+	boost::mpi::communicator world;
+
+	int ticks = (argc > 1) ? boost::lexical_cast<int>(argv[1]) : 1000;
+	int flush = (argc > 2) ? boost::lexical_cast<int>(argv[2]) : 100;
+
+	// Warm up the collectives
+	separate(world, 10);
+	packed(world, 10, 1);
+
+	double baseline = separate(world, ticks);
+	double slowest = 0;
+	boost::mpi::all_reduce(world, baseline, slowest,
+			boost::mpi::maximum<double>());
+	double baselinePerTick = (slowest / ticks) * 1e6;
+
+	if (world.rank() == 0) {
+		std::cout << "mode;processes;ticks;flush;us_per_tick;saved_us"
+				<< std::endl;
+	}
+	report(world, "separate", ticks, 1, baseline, baselinePerTick);
+	report(world, "packed", ticks, 1, packed(world, ticks, 1),
+			baselinePerTick);
+	report(world, "window", ticks, flush, packed(world, ticks, flush),
+			baselinePerTick);
+
+	return 0;
+}
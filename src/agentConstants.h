@@ -0,0 +1,32 @@
+#ifndef  __AGENTCONSTANTS_H__
+#define  __AGENTCONSTANTS_H__
+
+// Shared by the agents and the array store kernels, free of Repast
+
+// Action
+const int DEFECT = 0;
+const int COOPERATE = 1;
+
+// Strategy
+const int PTFT = 0;
+const int TFT = 1;
+const int RANDOM = 2;
+
+// Random streams, one per distribution
+const int STREAM_STRATEGY = 0;
+const int STREAM_CONSIDER_TRUST = 1;
+const int STREAM_DECISION_ACTION = 2;
+const int STREAM_ACTION = 3;
+const int STREAM_TRUST_LEADER = 4;
+
+// Draws of the action stream by the same agent in a round
+const int DRAW_DECIDE = 0;
+const int DRAW_LEAVE = 1;
+const int DRAW_DISSOLVE = 2;
+
+// Coalition decisions waiting to be applied
+const int PENDING_NONE = 0;
+const int PENDING_JOIN = 1;
+const int PENDING_LEAVE = 2;
+
+#endif // __AGENTCONSTANTS_H__
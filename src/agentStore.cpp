@@ -0,0 +1,238 @@
+#include "agentStore.h"
+
+#include <algorithm>
+
+#include "agentConstants.h"
+
+AgentStore::AgentStore() {
+	numLocal = 0;
+	numCells = 0;
+
+	deltaTrust = 0;
+	trustThreshold = 0;
+}
+
+AgentStore::~AgentStore() {
+}
+
+void AgentStore::resize(int _numLocal, int _numGhosts) {
+	numLocal = _numLocal;
+	numCells = _numLocal + _numGhosts;
+
+	id.assign(numCells, 0);
+	cell.assign(numCells, 0);
+	strategy.assign(numCells, 0);
+	considerTrust.assign(numCells, 0);
+	trustLeader.assign(numCells, 0);
+	status.assign(numCells, STATUS_INDEPENDENT);
+	leader.assign(numCells, 0);
+	action.assign(numCells, 0);
+	payoff.assign(numCells, 0);
+	numDefectors.assign(numCells, 0);
+	changed.assign(numLocal, 0);
+
+	pending.assign(numLocal, PENDING_NONE);
+	pendingLeader.assign(numLocal, 0);
+
+	neighborBegin.assign(numLocal + 1, 0);
+	neighbors.clear();
+}
+
+void AgentStore::decideCell(int _i, const CellRandom& _random) {
+	int numNeighbors = neighborBegin[_i + 1] - neighborBegin[_i];
+	int value = action[_i];
+
+	// pTFT
+	if (strategy[_i] == PTFT) {
+		if ((numDefectors[_i] / numNeighbors)
+				> _random.next(STREAM_DECISION_ACTION, cell[_i])) {
+			value = DEFECT;
+		} else {
+			value = COOPERATE;
+		}
+		// TFT
+	} else if (strategy[_i] == TFT) {
+		if (numDefectors[_i] > (numNeighbors / 2)) {
+			value = DEFECT;
+		} else {
+			value = COOPERATE;
+		}
+		// Random
+	} else if (strategy[_i] == RANDOM) {
+		value = (int) _random.next(STREAM_ACTION, cell[_i], DRAW_DECIDE);
+	}
+
+	if (value != action[_i]) {
+		action[_i] = value;
+		changed[_i] |= CHANGED_ACTION;
+	}
+}
+
+void AgentStore::payoffCell(int _i, int _payoffT, int _payoffR, int _payoffP,
+		int _payoffS) {
+	int numNeighbors = neighborBegin[_i + 1] - neighborBegin[_i];
+	const int* first = &neighbors[0] + neighborBegin[_i];
+	const int* last = first + numNeighbors;
+	int numCooperate = 0;
+	int numDefect = 0;
+	int numMember = 0;
+	double value = payoff[_i];
+
+	// Leader or Coalition Member
+	if (status[_i] & (STATUS_LEADER | STATUS_MEMBER)) {
+		for (const int* n = first; n != last; ++n) {
+			if (leader[*n] == leader[_i]) {
+				numMember++;
+			} else if (action[*n] == COOPERATE) {
+				numCooperate++;
+			} else if (action[*n] == DEFECT) {
+				numDefect++;
+			}
+		}
+		value = (numMember * _payoffR) + (numCooperate * _payoffT)
+				+ (numDefect * _payoffP);
+	} else if (status[_i] & STATUS_INDEPENDENT) {
+		if ((action[_i] == COOPERATE) || (action[_i] == DEFECT)) {
+			for (const int* n = first; n != last; ++n) {
+				if (action[*n] == COOPERATE) {
+					numCooperate++;
+				} else if (action[*n] == DEFECT) {
+					numDefect++;
+				}
+			}
+		}
+
+		// Independent and Cooperated
+		if (action[_i] == COOPERATE) {
+			value = (numCooperate * _payoffR) + (numDefect * _payoffS);
+		}
+		// Independent and Defected
+		else if (action[_i] == DEFECT) {
+			value = (numCooperate * _payoffT) + (numDefect * _payoffP);
+		}
+	}
+
+	value = value / (float) numNeighbors;
+	if ((value != payoff[_i]) || (numDefect != numDefectors[_i])) {
+		payoff[_i] = value;
+		numDefectors[_i] = numDefect;
+		changed[_i] |= CHANGED_PAYOFF;
+	}
+}
+
+void AgentStore::decideAction(const CellRandom& _random) {
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < numLocal; i++) {
+		decideCell(i, _random);
+	}
+}
+
+void AgentStore::decideAction(const CellRandom& _random,
+		const std::vector<int>& _cells) {
+	int size = _cells.size();
+
+#pragma omp parallel for schedule(static)
+	for (int k = 0; k < size; k++) {
+		decideCell(_cells[k], _random);
+	}
+}
+
+void AgentStore::calculatePayoff(int _payoffT, int _payoffR, int _payoffP,
+		int _payoffS) {
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < numLocal; i++) {
+		payoffCell(i, _payoffT, _payoffR, _payoffP, _payoffS);
+	}
+}
+
+void AgentStore::calculatePayoff(int _payoffT, int _payoffR, int _payoffP,
+		int _payoffS, const std::vector<int>& _cells) {
+	int size = _cells.size();
+
+#pragma omp parallel for schedule(static)
+	for (int k = 0; k < size; k++) {
+		payoffCell(_cells[k], _payoffT, _payoffR, _payoffP, _payoffS);
+	}
+}
+
+void AgentStore::decideCoalition(const CellRandom& _random) {
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < numLocal; i++) {
+		pending[i] = PENDING_NONE;
+		if (!(status[i] & (STATUS_MEMBER | STATUS_INDEPENDENT))) {
+			continue;
+		}
+
+		const int* first = &neighbors[0] + neighborBegin[i];
+		const int* last = &neighbors[0] + neighborBegin[i + 1];
+		bool worstPayoff = true;
+		int best = *first;
+
+		for (const int* n = first; n != last; ++n) {
+			if (payoff[*n] < payoff[i]) {
+				worstPayoff = false;
+			}
+			if (payoff[*n] > payoff[best]) {
+				best = *n;
+			}
+		}
+
+		if (status[i] & STATUS_INDEPENDENT) {
+			if (worstPayoff) {
+				long long value = leader[i];
+				if (status[best] & (STATUS_INDEPENDENT | STATUS_LEADER)) {
+					value = id[best];
+				} else if (status[best] & STATUS_MEMBER) {
+					value = leader[best];
+				}
+
+				pending[i] = PENDING_JOIN;
+				pendingLeader[i] = value;
+			}
+		} else if (status[i] & STATUS_MEMBER) {
+			bool leave = false;
+
+			if (considerTrust[i]) {
+				if (worstPayoff) {
+					trustLeader[i] = std::min(0.0,
+							(trustLeader[i] - deltaTrust));
+					leave = trustLeader[i] < trustThreshold;
+				} else {
+					trustLeader[i] = std::max((trustLeader[i] + deltaTrust),
+							1.0);
+				}
+				changed[i] |= CHANGED_TRUST;
+			} else {
+				leave = payoff[i] < (payoff[best] / 2.0);
+			}
+
+			if (leave) {
+				pending[i] = PENDING_LEAVE;
+			}
+		}
+	}
+
+	// Decisions are applied once every cell has decided
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < numLocal; i++) {
+		if (pending[i] == PENDING_JOIN) {
+			if (pendingLeader[i] != leader[i]) {
+				leader[i] = pendingLeader[i];
+				changed[i] |= CHANGED_LEADER;
+			}
+
+			status[i] = STATUS_MEMBER;
+			trustLeader[i] = _random.next(STREAM_TRUST_LEADER, cell[i]);
+			changed[i] |= CHANGED_STATUS | CHANGED_TRUST;
+		} else if (pending[i] == PENDING_LEAVE) {
+			status[i] = STATUS_INDEPENDENT;
+			changed[i] |= CHANGED_STATUS;
+
+			int value = (int) _random.next(STREAM_ACTION, cell[i], DRAW_LEAVE);
+			if (value != action[i]) {
+				action[i] = value;
+				changed[i] |= CHANGED_ACTION;
+			}
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#ifndef  __AGENTSTORE_H__
+#define  __AGENTSTORE_H__
+
+#include <vector>
+
+#include "cellRandom.h"
+
+// Status
+const unsigned char STATUS_INDEPENDENT = 1;
+const unsigned char STATUS_MEMBER = 2;
+const unsigned char STATUS_LEADER = 4;
+
+// Fields changed by the kernels since the last scatter
+const unsigned char CHANGED_ACTION = 1;
+const unsigned char CHANGED_PAYOFF = 2;
+const unsigned char CHANGED_STATUS = 4;
+const unsigned char CHANGED_LEADER = 8;
+const unsigned char CHANGED_TRUST = 16;
+
+/**
+ * Structure of arrays backing the agents of a process. Local cells take the
+ * slots [0, numLocal) and ghost cells the slots [numLocal, numCells). The
+ * local cells' neighbors are kept in a compressed sparse row index.
+ */
+class AgentStore {
+
+private:
+	void decideCell(int _i, const CellRandom& _random);
+	void payoffCell(int _i, int _payoffT, int _payoffR, int _payoffP,
+			int _payoffS);
+
+public:
+	int numLocal;
+	int numCells;
+
+	// Trust information, the same for every agent
+	double deltaTrust;
+	double trustThreshold;
+
+	// Agent, identifiers and leaders are agent keys, cells are the global
+	// cell ids keying the random draws
+	std::vector<long long> id;
+	std::vector<long long> cell;
+	std::vector<int> strategy;
+	std::vector<char> considerTrust;
+	std::vector<double> trustLeader;
+	std::vector<unsigned char> status;
+	std::vector<long long> leader;
+	std::vector<int> action;
+	std::vector<double> payoff;
+	std::vector<int> numDefectors;
+	std::vector<unsigned char> changed;
+
+	// Coalition decisions of the local cells
+	std::vector<unsigned char> pending;
+	std::vector<long long> pendingLeader;
+
+	// Neighbors of the local cell i are neighbors[neighborBegin[i]] up to
+	// neighbors[neighborBegin[i + 1]]
+	std::vector<int> neighborBegin;
+	std::vector<int> neighbors;
+
+	AgentStore();
+	~AgentStore();
+
+	void resize(int _numLocal, int _numGhosts);
+
+	/**
+	 * Local agents decide their cycle action
+	 */
+	void decideAction(const CellRandom& _random);
+	void decideAction(const CellRandom& _random,
+			const std::vector<int>& _cells);
+
+	/**
+	 * Local agents calculate their payoff based on their neighbors' actions
+	 */
+	void calculatePayoff(int _payoffT, int _payoffR, int _payoffP,
+			int _payoffS);
+	void calculatePayoff(int _payoffT, int _payoffR, int _payoffP,
+			int _payoffS, const std::vector<int>& _cells);
+
+	/**
+	 * Local independents and members decide to join/leave a coalition, all
+	 * of them from the neighbors' state before any decision is applied
+	 */
+	void decideCoalition(const CellRandom& _random);
+};
+
+#endif // __AGENTSTORE_H__
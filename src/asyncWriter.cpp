@@ -0,0 +1,113 @@
+#include "asyncWriter.h"
+
+#include <exception>
+#include <stdexcept>
+
+AsyncWriter::AsyncWriter(OutputSink* _sink, int _capacity) :
+		sink(_sink) {
+	capacity = (_capacity > 0) ? _capacity : 1;
+	closing = false;
+	closed = false;
+	thread = std::thread(&AsyncWriter::run, this);
+}
+
+AsyncWriter::~AsyncWriter() {
+	try {
+		close();
+	} catch (const std::exception&) {
+		// Reported by an explicit close
+	}
+	delete sink;
+}
+
+void AsyncWriter::run() {
+	// Once a write fails the remaining batches are dropped
+	bool failed = false;
+
+	while (true) {
+		OutputBatch batch;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			notEmpty.wait(guard, [this] {return closing || !queue.empty();});
+			if (queue.empty()) {
+				break;
+			}
+			batch.ticks.swap(queue.front().ticks);
+			batch.ints.swap(queue.front().ints);
+			batch.doubles.swap(queue.front().doubles);
+		}
+
+		// The batch keeps its slot while written, so at most capacity
+		// batches are held
+		try {
+			if (!failed) {
+				sink->write(batch);
+			}
+		} catch (const std::exception& e) {
+			std::lock_guard<std::mutex> guard(lock);
+			error = e.what();
+			failed = true;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			queue.pop_front();
+		}
+		notFull.notify_one();
+	}
+
+	try {
+		if (!failed) {
+			sink->close();
+		}
+	} catch (const std::exception& e) {
+		std::lock_guard<std::mutex> guard(lock);
+		error = e.what();
+	}
+}
+
+void AsyncWriter::raise() {
+	std::lock_guard<std::mutex> guard(lock);
+	if (!error.empty()) {
+		std::string message = error;
+		error = "";
+		throw std::runtime_error(message);
+	}
+}
+
+void AsyncWriter::push(OutputBatch& _batch) {
+	raise();
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		notFull.wait(guard, [this] {return queue.size() < capacity;});
+		queue.push_back(OutputBatch());
+		queue.back().ticks.swap(_batch.ticks);
+		queue.back().ints.swap(_batch.ints);
+		queue.back().doubles.swap(_batch.doubles);
+	}
+	notEmpty.notify_one();
+}
+
+void AsyncWriter::drain() {
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		notFull.wait(guard, [this] {return queue.empty();});
+	}
+	raise();
+}
+
+void AsyncWriter::close() {
+	if (closed) {
+		return;
+	}
+	closed = true;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		closing = true;
+	}
+	notEmpty.notify_one();
+	thread.join();
+
+	raise();
+}
@@ -0,0 +1,63 @@
+#ifndef  __ASYNCWRITER_H__
+#define  __ASYNCWRITER_H__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "outputSink.h"
+
+/**
+ * Writes batches to a sink on a background thread. The queue holds at most
+ * capacity batches, a full queue blocks the caller so memory stays bounded.
+ * Only the calling thread touches MPI.
+ */
+class AsyncWriter {
+
+private:
+	OutputSink* sink;
+	size_t capacity;
+
+	std::deque<OutputBatch> queue;
+	std::mutex lock;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+	bool closing;
+	bool closed;
+
+	// First error of the writer thread, raised on the calling thread
+	std::string error;
+
+	std::thread thread;
+
+	void run();
+	void raise();
+
+public:
+	/**
+	 * Takes ownership of the sink
+	 */
+	AsyncWriter(OutputSink* _sink, int _capacity);
+	~AsyncWriter();
+
+	/**
+	 * Queues a batch, the batch is left empty
+	 */
+	void push(OutputBatch& _batch);
+
+	/**
+	 * Waits until the queued batches are written. Throws std::runtime_error
+	 * if any write failed.
+	 */
+	void drain();
+
+	/**
+	 * Writes the queued batches, closes the sink and stops the thread.
+	 * Throws std::runtime_error if any write failed.
+	 */
+	void close();
+};
+
+#endif // __ASYNCWRITER_H__
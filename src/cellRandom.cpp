@@ -0,0 +1,60 @@
+#include "cellRandom.h"
+
+#include <sstream>
+#include <stdexcept>
+
+CellDistribution CellDistribution::parse(const std::string& _definition) {
+	CellDistribution distribution;
+	std::istringstream in(_definition);
+	std::string type;
+	char separator = 0;
+
+	std::getline(in, type, ',');
+	type.erase(0, type.find_first_not_of(" \t"));
+	type.erase(type.find_last_not_of(" \t") + 1);
+
+	in >> distribution.from >> separator >> distribution.to;
+	if ((!in) || (separator != ',')) {
+		throw std::invalid_argument("Invalid distribution: " + _definition);
+	}
+
+	if (type == "int_uniform") {
+		distribution.integer = true;
+	} else if (type == "double_uniform") {
+		distribution.integer = false;
+	} else {
+		throw std::invalid_argument("Unsupported distribution: " + type);
+	}
+
+	return distribution;
+}
+
+CellRandom::CellRandom() {
+	key0 = 0;
+	key1 = 0;
+	round = 0;
+}
+
+CellRandom::~CellRandom() {
+}
+
+void CellRandom::seed(uint32_t _seed) {
+	key0 = _seed;
+	key1 = 0x6A09E667;
+}
+
+void CellRandom::setRound(int _round) {
+	round = _round;
+}
+
+int CellRandom::getRound() const {
+	return round;
+}
+
+void CellRandom::setDistribution(int _stream,
+		const CellDistribution& _distribution) {
+	if (_stream >= (int) distributions.size()) {
+		distributions.resize(_stream + 1);
+	}
+	distributions[_stream] = _distribution;
+}
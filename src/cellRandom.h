@@ -0,0 +1,100 @@
+#ifndef  __CELLRANDOM_H__
+#define  __CELLRANDOM_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Distribution of a random stream, as given by a distribution.* property
+ * ("int_uniform, from, to" or "double_uniform, from, to")
+ */
+struct CellDistribution {
+	bool integer;
+	double from;
+	double to;
+
+	static CellDistribution parse(const std::string& _definition);
+};
+
+/**
+ * Counter-based generator (Philox4x32-10). A draw is a pure function of
+ * the seed and the counter (cell, round, stream, draw), so draws neither
+ * depend on the number of processes or threads nor on the order in which
+ * the agents are visited.
+ */
+class CellRandom {
+
+private:
+	uint32_t key0;
+	uint32_t key1;
+	uint32_t round;
+	std::vector<CellDistribution> distributions;
+
+	static inline uint32_t mulhilo(uint32_t _a, uint32_t _b, uint32_t& _hi) {
+		uint64_t product = (uint64_t) _a * _b;
+		_hi = (uint32_t) (product >> 32);
+		return (uint32_t) product;
+	}
+
+public:
+	CellRandom();
+	~CellRandom();
+
+	void seed(uint32_t _seed);
+
+	/**
+	 * Round used by the following draws
+	 */
+	void setRound(int _round);
+	int getRound() const;
+
+	void setDistribution(int _stream, const CellDistribution& _distribution);
+
+	/**
+	 * Uniform double in [0, 1) for the given counter
+	 */
+	inline double uniform(uint32_t _cell, uint32_t _round, uint32_t _stream,
+			uint32_t _draw) const {
+		uint32_t c0 = _cell;
+		uint32_t c1 = _round;
+		uint32_t c2 = _stream;
+		uint32_t c3 = _draw;
+		uint32_t k0 = key0;
+		uint32_t k1 = key1;
+
+		for (int r = 0; r < 10; r++) {
+			uint32_t hi0;
+			uint32_t hi1;
+			uint32_t lo0 = mulhilo(0xD2511F53, c0, hi0);
+			uint32_t lo1 = mulhilo(0xCD9E8D57, c2, hi1);
+
+			c0 = hi1 ^ c1 ^ k0;
+			c1 = lo1;
+			c2 = hi0 ^ c3 ^ k1;
+			c3 = lo0;
+
+			k0 += 0x9E3779B9;
+			k1 += 0xBB67AE85;
+		}
+
+		uint64_t bits = ((uint64_t) c0 << 21) ^ (uint64_t) c1;
+		return (double) (bits & 0x1FFFFFFFFFFFFFULL) * (1.0 / 9007199254740992.0);
+	}
+
+	/**
+	 * Draw of a stream's distribution for a cell in the current round
+	 */
+	inline double next(int _stream, long long _cell, int _draw = 0) const {
+		const CellDistribution& distribution = distributions[_stream];
+		double u = uniform((uint32_t) _cell, round, _stream, _draw);
+
+		if (distribution.integer) {
+			return distribution.from
+					+ (long long) (u * (distribution.to - distribution.from + 1));
+		}
+		return distribution.from + (u * (distribution.to - distribution.from));
+	}
+};
+
+#endif // __CELLRANDOM_H__
@@ -0,0 +1,98 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+Checkpoint::Checkpoint() {
+}
+
+Checkpoint::~Checkpoint() {
+}
+
+void Checkpoint::setDirectory(const std::string& _directory,
+		const std::string& _task) {
+	directory = _directory;
+	task = _task;
+}
+
+std::string Checkpoint::latestFile() const {
+	return directory + "/latest" + task;
+}
+
+std::string Checkpoint::fileName(int _round, int _rank) const {
+	std::ostringstream name;
+	name << directory << "/checkpoint" << task << "_" << _round << "_" << _rank << ".bin";
+	return name.str();
+}
+
+bool Checkpoint::write(const CheckpointHeader& _header,
+		const std::vector<AgentCheckpoint>& _agents) const {
+	std::string file = fileName(_header.round, _header.rank);
+	std::string temporary = file + ".tmp";
+
+	// Written aside and renamed, a failure never leaves a partial file
+	std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+	out.write((const char*) &_header, sizeof(CheckpointHeader));
+	if (!_agents.empty()) {
+		out.write((const char*) &_agents[0],
+				_agents.size() * sizeof(AgentCheckpoint));
+	}
+	out.close();
+
+	if (!out) {
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return std::rename(temporary.c_str(), file.c_str()) == 0;
+}
+
+void Checkpoint::read(int _round, int _rank, CheckpointHeader& _header,
+		std::vector<AgentCheckpoint>& _agents) const {
+	std::string file = fileName(_round, _rank);
+	std::ifstream in(file.c_str(), std::ios::binary);
+
+	in.read((char*) &_header, sizeof(CheckpointHeader));
+	if ((!in) || (_header.magic != MAGIC) || (_header.version != VERSION)) {
+		throw std::runtime_error("Invalid checkpoint: " + file);
+	}
+
+	_agents.resize(_header.numAgents);
+	if (!_agents.empty()) {
+		in.read((char*) &_agents[0],
+				_agents.size() * sizeof(AgentCheckpoint));
+	}
+	if (!in) {
+		throw std::runtime_error("Truncated checkpoint: " + file);
+	}
+}
+
+bool Checkpoint::commit(int _round) const {
+	std::string file = latestFile();
+	std::string temporary = file + ".tmp";
+
+	std::ofstream out(temporary.c_str(), std::ios::trunc);
+	out << _round << std::endl;
+	out.close();
+
+	if (!out) {
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return std::rename(temporary.c_str(), file.c_str()) == 0;
+}
+
+int Checkpoint::latest() const {
+	std::ifstream in(latestFile().c_str());
+	int round = -1;
+
+	if (!(in >> round)) {
+		return -1;
+	}
+	return round;
+}
+
+void Checkpoint::remove(int _round, int _rank) const {
+	std::remove(fileName(_round, _rank).c_str());
+}
@@ -0,0 +1,98 @@
+#ifndef  __CHECKPOINT_H__
+#define  __CHECKPOINT_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Identifies a checkpoint and the run that wrote it, a restart needs the
+ * same grid, processes and seed
+ */
+struct CheckpointHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seed;
+	int round;
+	int rank;
+	int worldSize;
+	int sizeX;
+	int sizeY;
+	int numAgents;
+};
+
+/**
+ * State of a local agent carried from one round to the next, everything
+ * else is rebuilt from it
+ */
+struct AgentCheckpoint {
+	double trustLeader;
+	double payoff;
+	double coalitionPayoff;
+	long long leader;
+	int id;
+	int strategy;
+	int action;
+	int numDefectors;
+	char considerTrust;
+	char isIndependent;
+	char isMember;
+	char isLeader;
+};
+
+/**
+ * Binary checkpoints, one file per process and round. A checkpoint only
+ * counts once every process has written its file and the first process has
+ * recorded its round as the latest.
+ */
+class Checkpoint {
+
+private:
+	std::string directory;
+	std::string task;
+
+	std::string latestFile() const;
+
+public:
+	static const uint32_t MAGIC = 0x4b434354; // "TCCK"
+	static const uint32_t VERSION = 1;
+
+	Checkpoint();
+	~Checkpoint();
+
+	/**
+	 * Tasks of an ensemble share the directory, each one names its files
+	 * with its own task suffix
+	 */
+	void setDirectory(const std::string& _directory,
+			const std::string& _task);
+
+	std::string fileName(int _round, int _rank) const;
+
+	/**
+	 * Writes the file of a process, false if it could not be written
+	 */
+	bool write(const CheckpointHeader& _header,
+			const std::vector<AgentCheckpoint>& _agents) const;
+
+	/**
+	 * Reads the file of a process, throws std::runtime_error if it is
+	 * missing or truncated
+	 */
+	void read(int _round, int _rank, CheckpointHeader& _header,
+			std::vector<AgentCheckpoint>& _agents) const;
+
+	/**
+	 * Records the round of the latest complete checkpoint
+	 */
+	bool commit(int _round) const;
+
+	/**
+	 * Round of the latest complete checkpoint, -1 if there is none
+	 */
+	int latest() const;
+
+	void remove(int _round, int _rank) const;
+};
+
+#endif // __CHECKPOINT_H__
@@ -0,0 +1,20 @@
+#include "coalitionSplit.h"
+
+double splitCoalitionPayoff(double _coalitionPayoff,
+		const std::vector<std::pair<int, double> >& _contributions,
+		int _numMembers, float _tax, double& _leaderPayoff) {
+	// Single precision contributions
+	for (int c = 0, size = _contributions.size(); c < size; c++) {
+		_coalitionPayoff += (float) _contributions[c].second;
+	}
+
+	if (_numMembers == 0) {
+		return 0;
+	}
+
+	// Leader receives its payoff plus the coalition members' tax
+	_leaderPayoff += _coalitionPayoff * _tax;
+
+	// Members receive an even portion of the coalition's payoff
+	return (_coalitionPayoff * (1.0 - _tax)) / (double) _numMembers;
+}
@@ -0,0 +1,17 @@
+#ifndef  __COALITIONSPLIT_H__
+#define  __COALITIONSPLIT_H__
+
+#include <utility>
+#include <vector>
+
+/**
+ * Splits the payoff of a coalition, free of Repast. The contributions
+ * (member cell, payoff) are added in their order to the leader's coalition
+ * payoff, the leader receives the tax on the sum and the members an even
+ * portion of the rest. Returns the members' portion, 0 without members.
+ */
+double splitCoalitionPayoff(double _coalitionPayoff,
+		const std::vector<std::pair<int, double> >& _contributions,
+		int _numMembers, float _tax, double& _leaderPayoff);
+
+#endif // __COALITIONSPLIT_H__
@@ -0,0 +1,317 @@
+#include "commCounters.h"
+
+#include <fstream>
+
+namespace {
+
+// World ranks of the processes of a communicator, and its out-neighbors if
+// it is a distributed graph, cached as an attribute of the communicator
+struct CommPeers {
+	MPI_Comm world;
+	std::vector<int> ranks;
+	std::vector<int> destinations;
+};
+
+int peersKey = MPI_KEYVAL_INVALID;
+
+int deletePeers(MPI_Comm, int, void* _value, void*) {
+	delete (CommPeers*) _value;
+	return MPI_SUCCESS;
+}
+
+CommPeers* peersOf(MPI_Comm _comm, MPI_Comm _world, MPI_Group _group) {
+	if (peersKey == MPI_KEYVAL_INVALID) {
+		MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, deletePeers, &peersKey,
+				0);
+	}
+
+	CommPeers* peers = 0;
+	int found = 0;
+	MPI_Comm_get_attr(_comm, peersKey, &peers, &found);
+	if ((found) && (peers->world == _world)) {
+		return peers;
+	}
+	if (found) {
+		MPI_Comm_delete_attr(_comm, peersKey);
+	}
+
+	peers = new CommPeers();
+	peers->world = _world;
+
+	int inter = 0;
+	MPI_Comm_test_inter(_comm, &inter);
+	if (!inter) {
+		MPI_Group group;
+		int size = 0;
+		MPI_Comm_group(_comm, &group);
+		MPI_Group_size(group, &size);
+
+		std::vector<int> ranks(size);
+		for (int r = 0; r < size; r++) {
+			ranks[r] = r;
+		}
+		peers->ranks.resize(size);
+		MPI_Group_translate_ranks(group, size, &ranks[0], _group,
+				&peers->ranks[0]);
+		MPI_Group_free(&group);
+
+		int topology = MPI_UNDEFINED;
+		MPI_Topo_test(_comm, &topology);
+		if (topology == MPI_DIST_GRAPH) {
+			int inDegree = 0;
+			int outDegree = 0;
+			int weighted = 0;
+			MPI_Dist_graph_neighbors_count(_comm, &inDegree, &outDegree,
+					&weighted);
+
+			std::vector<int> sources(inDegree + 1);
+			peers->destinations.resize(outDegree + 1);
+			MPI_Dist_graph_neighbors(_comm, inDegree, &sources[0],
+					MPI_UNWEIGHTED, outDegree, &peers->destinations[0],
+					MPI_UNWEIGHTED);
+			peers->destinations.resize(outDegree);
+		}
+	}
+
+	MPI_Comm_set_attr(_comm, peersKey, peers);
+	return peers;
+}
+
+void countSend(int _count, MPI_Datatype _type, int _dest, MPI_Comm _comm) {
+	if ((CommCounters::active == 0) || (_dest == MPI_PROC_NULL)) {
+		return;
+	}
+
+	int typeSize = 0;
+	MPI_Type_size(_type, &typeSize);
+	CommCounters::active->addMessage(_comm, _dest, (long) _count * typeSize);
+}
+
+void countNeighbors(const int* _counts, int _count, MPI_Datatype _type,
+		MPI_Comm _comm) {
+	if (CommCounters::active == 0) {
+		return;
+	}
+
+	int typeSize = 0;
+	MPI_Type_size(_type, &typeSize);
+	CommCounters::active->addNeighborMessages(_comm, _counts, _count,
+			typeSize);
+}
+
+}
+
+CommCounters* CommCounters::active = 0;
+
+CommCounters::CommCounters() {
+	world = MPI_COMM_NULL;
+	group = MPI_GROUP_NULL;
+	size = 0;
+	round = 0;
+	phase = PHASE_OTHER;
+}
+
+CommCounters::~CommCounters() {
+	int finalized = 0;
+
+	stop();
+
+	MPI_Finalized(&finalized);
+	if ((!finalized) && (group != MPI_GROUP_NULL)) {
+		MPI_Group_free(&group);
+	}
+}
+
+void CommCounters::start(MPI_Comm _world) {
+	world = _world;
+	MPI_Comm_group(world, &group);
+	MPI_Comm_size(world, &size);
+
+	messagesTo.assign(size, 0);
+	bytesTo.assign(size, 0);
+	lastSent.assign(size, -1);
+
+	active = this;
+}
+
+void CommCounters::stop() {
+	if (active == this) {
+		active = 0;
+	}
+}
+
+void CommCounters::setRound(int _round) {
+	round = _round;
+}
+
+void CommCounters::setPhase(int _phase) {
+	phase = _phase;
+}
+
+long* CommCounters::at(int _counter) {
+	size_t index = ((((size_t) round * (NUM_PHASES + 1)) + phase)
+			* NUM_COMM_COUNTERS) + _counter;
+	if (index >= counts.size()) {
+		counts.resize((index / NUM_COMM_COUNTERS + 1) * NUM_COMM_COUNTERS, 0);
+	}
+	return &counts[index];
+}
+
+void CommCounters::addMessage(MPI_Comm _comm, int _dest, long _bytes) {
+	const std::vector<int>& ranks = peersOf(_comm, world, group)->ranks;
+	if ((_dest < 0) || (_dest >= (int) ranks.size())
+			|| (ranks[_dest] == MPI_UNDEFINED)) {
+		return;
+	}
+
+	int to = ranks[_dest];
+	messagesTo[to]++;
+	bytesTo[to] += _bytes;
+
+	*at(COMM_MESSAGES) += 1;
+	*at(COMM_BYTES) += _bytes;
+
+	// Distinct processes sent to in the round and phase
+	long stamp = ((long) round * (NUM_PHASES + 1)) + phase;
+	if (lastSent[to] != stamp) {
+		lastSent[to] = stamp;
+		*at(COMM_PEERS) += 1;
+	}
+}
+
+void CommCounters::addNeighborMessages(MPI_Comm _comm, const int* _counts,
+		int _count, int _typeSize) {
+	const std::vector<int>& destinations =
+			peersOf(_comm, world, group)->destinations;
+	for (int k = 0, size = destinations.size(); k < size; k++) {
+		int count = (_counts != 0) ? _counts[k] : _count;
+		addMessage(_comm, destinations[k], (long) count * _typeSize);
+	}
+}
+
+void CommCounters::report(MPI_Comm _world, const std::string& _countsFile,
+		const std::string& _bytesFile,
+		const std::string& _messagesFile) const {
+	int rank = 0;
+	int worldSize = 0;
+	MPI_Comm_rank(_world, &rank);
+	MPI_Comm_size(_world, &worldSize);
+
+	// Processes may have counted up to different rounds
+	long localLength = counts.size();
+	long length = 0;
+	MPI_Allreduce(&localLength, &length, 1, MPI_LONG, MPI_MAX, _world);
+
+	std::vector<long> local(counts);
+	local.resize(length + 1, 0);
+	std::vector<long> sums(rank == 0 ? length + 1 : 1);
+	std::vector<long> maxima(rank == 0 ? length + 1 : 1);
+	MPI_Reduce(&local[0], &sums[0], length, MPI_LONG, MPI_SUM, 0, _world);
+	MPI_Reduce(&local[0], &maxima[0], length, MPI_LONG, MPI_MAX, 0, _world);
+
+	std::vector<long> allMessages(rank == 0 ? worldSize * worldSize : 1);
+	std::vector<long> allBytes(rank == 0 ? worldSize * worldSize : 1);
+	std::vector<long> sentMessages(messagesTo);
+	std::vector<long> sentBytes(bytesTo);
+	sentMessages.resize(worldSize, 0);
+	sentBytes.resize(worldSize, 0);
+	MPI_Gather(&sentMessages[0], worldSize, MPI_LONG, &allMessages[0],
+			worldSize, MPI_LONG, 0, _world);
+	MPI_Gather(&sentBytes[0], worldSize, MPI_LONG, &allBytes[0], worldSize,
+			MPI_LONG, 0, _world);
+
+	if (rank != 0) {
+		return;
+	}
+
+	std::ofstream out(_countsFile.c_str(), std::ios::trunc);
+	out << "round;phase;packagesSent;packagesReceived;messages;bytes;"
+			<< "maxBytes;peers;maxPeers" << std::endl;
+	for (long row = 0; row < length / NUM_COMM_COUNTERS; row++) {
+		const long* sum = &sums[row * NUM_COMM_COUNTERS];
+		const long* max = &maxima[row * NUM_COMM_COUNTERS];
+
+		bool empty = true;
+		for (int c = 0; c < NUM_COMM_COUNTERS; c++) {
+			empty &= (sum[c] == 0);
+		}
+		if (empty) {
+			continue;
+		}
+
+		int p = row % (NUM_PHASES + 1);
+		out << (row / (NUM_PHASES + 1)) << ";"
+				<< ((p == PHASE_OTHER) ? "other" : PhaseProfiler::NAMES[p])
+				<< ";" << sum[COMM_PACKAGES_SENT] << ";"
+				<< sum[COMM_PACKAGES_RECEIVED] << ";" << sum[COMM_MESSAGES]
+				<< ";" << sum[COMM_BYTES] << ";" << max[COMM_BYTES] << ";"
+				<< sum[COMM_PEERS] << ";" << max[COMM_PEERS] << std::endl;
+	}
+
+	const std::string* files[2] = { &_bytesFile, &_messagesFile };
+	const std::vector<long>* matrices[2] = { &allBytes, &allMessages };
+	for (int m = 0; m < 2; m++) {
+		std::ofstream matrix(files[m]->c_str(), std::ios::trunc);
+		matrix << "from";
+		for (int to = 0; to < worldSize; to++) {
+			matrix << ";" << to;
+		}
+		matrix << std::endl;
+
+		for (int from = 0; from < worldSize; from++) {
+			matrix << from;
+			for (int to = 0; to < worldSize; to++) {
+				matrix << ";" << (*matrices[m])[(from * worldSize) + to];
+			}
+			matrix << std::endl;
+		}
+	}
+}
+
+/**
+ * PMPI wrappers, the sends go through unchanged
+ */
+extern "C" {
+
+int MPI_Send(const void* buf, int count, MPI_Datatype datatype, int dest,
+		int tag, MPI_Comm comm) {
+	countSend(count, datatype, dest, comm);
+	return PMPI_Send(buf, count, datatype, dest, tag, comm);
+}
+
+int MPI_Ssend(const void* buf, int count, MPI_Datatype datatype, int dest,
+		int tag, MPI_Comm comm) {
+	countSend(count, datatype, dest, comm);
+	return PMPI_Ssend(buf, count, datatype, dest, tag, comm);
+}
+
+int MPI_Isend(const void* buf, int count, MPI_Datatype datatype, int dest,
+		int tag, MPI_Comm comm, MPI_Request* request) {
+	countSend(count, datatype, dest, comm);
+	return PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+}
+
+int MPI_Issend(const void* buf, int count, MPI_Datatype datatype, int dest,
+		int tag, MPI_Comm comm, MPI_Request* request) {
+	countSend(count, datatype, dest, comm);
+	return PMPI_Issend(buf, count, datatype, dest, tag, comm, request);
+}
+
+int MPI_Neighbor_alltoall(const void* sendbuf, int sendcount,
+		MPI_Datatype sendtype, void* recvbuf, int recvcount,
+		MPI_Datatype recvtype, MPI_Comm comm) {
+	countNeighbors(0, sendcount, sendtype, comm);
+	return PMPI_Neighbor_alltoall(sendbuf, sendcount, sendtype, recvbuf,
+			recvcount, recvtype, comm);
+}
+
+int MPI_Neighbor_alltoallv(const void* sendbuf, const int sendcounts[],
+		const int sdispls[], MPI_Datatype sendtype, void* recvbuf,
+		const int recvcounts[], const int rdispls[], MPI_Datatype recvtype,
+		MPI_Comm comm) {
+	countNeighbors(sendcounts, 0, sendtype, comm);
+	return PMPI_Neighbor_alltoallv(sendbuf, sendcounts, sdispls, sendtype,
+			recvbuf, recvcounts, rdispls, recvtype, comm);
+}
+
+}
@@ -0,0 +1,111 @@
+#ifndef  __COMMCOUNTERS_H__
+#define  __COMMCOUNTERS_H__
+
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+#include "phaseProfiler.h"
+
+// Counters kept per round and phase
+const int COMM_PACKAGES_SENT = 0;
+const int COMM_PACKAGES_RECEIVED = 1;
+const int COMM_MESSAGES = 2;
+const int COMM_BYTES = 3;
+const int COMM_PEERS = 4;
+const int NUM_COMM_COUNTERS = 5;
+
+// Traffic outside of any phase
+const int PHASE_OTHER = NUM_PHASES;
+
+/**
+ * Packages, messages, bytes and peers of each round and phase, and the
+ * messages and bytes sent to each process over the run. Packages are
+ * counted by the model's package callbacks, messages and bytes by the
+ * PMPI wrappers of the point-to-point sends and of the neighborhood
+ * all-to-alls, on the sending side. Other collectives are not counted.
+ */
+class CommCounters {
+
+private:
+	MPI_Comm world;
+	MPI_Group group;
+	int size;
+	int round;
+	int phase;
+
+	// Per round, phase and counter
+	std::vector<long> counts;
+
+	// Per destination process over the run
+	std::vector<long> messagesTo;
+	std::vector<long> bytesTo;
+
+	// Stamp of the last round and phase each process was sent to
+	std::vector<long> lastSent;
+
+	long* at(int _counter);
+
+public:
+	/**
+	 * Counting instance the wrappers report to, 0 if none
+	 */
+	static CommCounters* active;
+
+	CommCounters();
+	~CommCounters();
+
+	/**
+	 * Starts counting the traffic between the processes of the world
+	 */
+	void start(MPI_Comm _world);
+
+	/**
+	 * Stops counting, traffic after this is left out
+	 */
+	void stop();
+
+	void setRound(int _round);
+
+	/**
+	 * Phase of the traffic that follows, PHASE_OTHER if none
+	 */
+	void setPhase(int _phase);
+
+	inline void addSentPackages(long _packages) {
+		if (active == this) {
+			*at(COMM_PACKAGES_SENT) += _packages;
+		}
+	}
+
+	inline void addReceivedPackages(long _packages) {
+		if (active == this) {
+			*at(COMM_PACKAGES_RECEIVED) += _packages;
+		}
+	}
+
+	/**
+	 * A message of the bytes to the process of the communicator
+	 */
+	void addMessage(MPI_Comm _comm, int _dest, long _bytes);
+
+	/**
+	 * A message to each out-neighbor of a distributed graph, of counts[k]
+	 * elements to the k-th one, or of count elements if counts is 0
+	 */
+	void addNeighborMessages(MPI_Comm _comm, const int* _counts, int _count,
+			int _typeSize);
+
+	/**
+	 * Collective, the first process writes the totals and maxima over the
+	 * processes of each round and phase to the counts file, and the bytes
+	 * and messages sent by each process (row) to each process (column) to
+	 * the matrix files
+	 */
+	void report(MPI_Comm _world, const std::string& _countsFile,
+			const std::string& _bytesFile,
+			const std::string& _messagesFile) const;
+};
+
+#endif // __COMMCOUNTERS_H__
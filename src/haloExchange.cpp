@@ -0,0 +1,146 @@
+#include "haloExchange.h"
+
+#include <algorithm>
+
+#include "landModel.h"
+
+// Tags on the exchange communicator
+const int TAG_ACTIONS = 1;
+const int TAG_LEADERS = 2;
+
+/**
+ * Orders agents by their local id
+ */
+static bool byLocalId(LandAgent* _a, LandAgent* _b) {
+	return _a->getId().id() < _b->getId().id();
+}
+
+HaloExchange::HaloExchange() {
+}
+
+HaloExchange::~HaloExchange() {
+}
+
+void HaloExchange::build(boost::mpi::communicator* _world,
+		const std::vector<LandAgent*>& _ghosts,
+		repast::SharedContext<LandAgent>& _agents) {
+	comm = boost::mpi::communicator(*_world, boost::mpi::comm_duplicate);
+	int size = comm.size();
+	int rank = comm.rank();
+
+	// Ghosts grouped by owner process, agents never move
+	std::vector<std::vector<LandAgent*> > owned(size);
+	for (int g = 0, numGhosts = _ghosts.size(); g < numGhosts; g++) {
+		owned[_ghosts[g]->getId().startingRank()].push_back(_ghosts[g]);
+	}
+
+	std::vector<std::vector<int> > wanted(size);
+	std::vector<std::vector<int> > requested;
+	for (int p = 0; p < size; p++) {
+		std::sort(owned[p].begin(), owned[p].end(), byLocalId);
+		for (int g = 0, numGhosts = owned[p].size(); g < numGhosts; g++) {
+			wanted[p].push_back(owned[p][g]->getId().id());
+		}
+	}
+
+	boost::mpi::all_to_all(comm, wanted, requested);
+
+	for (int p = 0; p < size; p++) {
+		if (!owned[p].empty()) {
+			int words = (owned[p].size() + 63) / 64;
+
+			recvPeers.push_back(p);
+			recvAgents.push_back(owned[p]);
+			recvBits.push_back(std::vector<uint64_t>(words, 0));
+			recvLeaders.push_back(std::vector<long long>(owned[p].size(), 0));
+		}
+
+		if (!requested[p].empty()) {
+			int words = (requested[p].size() + 63) / 64;
+			std::vector<LandAgent*> sent;
+
+			for (int i = 0, numSent = requested[p].size(); i < numSent; i++) {
+				sent.push_back(
+						_agents.getAgent(
+								repast::AgentId(requested[p][i], rank,
+										AGENT_TYPE)));
+			}
+
+			sendPeers.push_back(p);
+			sendAgents.push_back(sent);
+			sendBits.push_back(std::vector<uint64_t>(words, 0));
+			sendLeaders.push_back(std::vector<long long>());
+
+			// No leader is known yet, the first stripe is always sent
+			lastLeaders.push_back(std::vector<long long>(sent.size(), -1));
+		}
+	}
+}
+
+void HaloExchange::start() {
+	bitRequests.clear();
+	leaderRequests.clear();
+	sendRequests.clear();
+
+	// Receive sizes are fixed, the leader stripe arrives empty if unchanged
+	for (int k = 0, numPeers = recvPeers.size(); k < numPeers; k++) {
+		bitRequests.push_back(
+				comm.irecv(recvPeers[k], TAG_ACTIONS, &recvBits[k][0],
+						recvBits[k].size()));
+		leaderRequests.push_back(
+				comm.irecv(recvPeers[k], TAG_LEADERS, &recvLeaders[k][0],
+						recvLeaders[k].size()));
+	}
+
+	for (int k = 0, numPeers = sendPeers.size(); k < numPeers; k++) {
+		const std::vector<LandAgent*>& sent = sendAgents[k];
+		std::vector<uint64_t>& bits = sendBits[k];
+		std::vector<long long>& last = lastLeaders[k];
+		bool changed = false;
+
+		std::fill(bits.begin(), bits.end(), 0);
+		for (int i = 0, numSent = sent.size(); i < numSent; i++) {
+			bits[i >> 6] |= (uint64_t) (sent[i]->getAction() == COOPERATE)
+					<< (i & 63);
+
+			long long leader = LandModel::agentKey(sent[i]->getLeaderId());
+			if (leader != last[i]) {
+				last[i] = leader;
+				changed = true;
+			}
+		}
+
+		sendLeaders[k].clear();
+		if (changed) {
+			sendLeaders[k] = last;
+		}
+
+		sendRequests.push_back(
+				comm.isend(sendPeers[k], TAG_ACTIONS, &bits[0], bits.size()));
+		sendRequests.push_back(
+				comm.isend(sendPeers[k], TAG_LEADERS, sendLeaders[k].data(),
+						sendLeaders[k].size()));
+	}
+}
+
+void HaloExchange::finish() {
+	boost::mpi::wait_all(bitRequests.begin(), bitRequests.end());
+
+	for (int k = 0, numPeers = recvPeers.size(); k < numPeers; k++) {
+		const std::vector<LandAgent*>& ghosts = recvAgents[k];
+		const std::vector<uint64_t>& bits = recvBits[k];
+		boost::mpi::status status = leaderRequests[k].wait();
+		bool leaders = (*status.count<long long>()) > 0;
+
+		for (int i = 0, numGhosts = ghosts.size(); i < numGhosts; i++) {
+			bool cooperated = (bits[i >> 6] >> (i & 63)) & 1;
+			ghosts[i]->setAction(cooperated ? COOPERATE : DEFECT);
+
+			if (leaders) {
+				ghosts[i]->setLeaderId(LandModel::agentId(recvLeaders[k][i]));
+			}
+		}
+	}
+
+	boost::mpi::wait_all(sendRequests.begin(), sendRequests.end());
+}
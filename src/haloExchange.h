@@ -0,0 +1,63 @@
+#ifndef  __HALOEXCHANGE_H__
+#define  __HALOEXCHANGE_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include <boost/mpi.hpp>
+#include <repast_hpc/SharedContext.h>
+
+class LandAgent;
+
+/**
+ * Lightweight buffer exchange of the decide action phase. Each ghost only
+ * needs its action and leader, so actions travel as one bit per cell and
+ * leaders as a separate stripe, sent empty unless one of them changed.
+ */
+class HaloExchange {
+
+private:
+	// Own communicator, the exchange tags cannot clash with Repast's
+	boost::mpi::communicator comm;
+
+	// Local agents sent to each send peer, in the order they expect
+	std::vector<int> sendPeers;
+	std::vector<std::vector<LandAgent*> > sendAgents;
+	std::vector<std::vector<uint64_t> > sendBits;
+	std::vector<std::vector<long long> > sendLeaders;
+	std::vector<std::vector<long long> > lastLeaders;
+
+	// Ghosts received from each receive peer
+	std::vector<int> recvPeers;
+	std::vector<std::vector<LandAgent*> > recvAgents;
+	std::vector<std::vector<uint64_t> > recvBits;
+	std::vector<std::vector<long long> > recvLeaders;
+
+	std::vector<boost::mpi::request> bitRequests;
+	std::vector<boost::mpi::request> leaderRequests;
+	std::vector<boost::mpi::request> sendRequests;
+
+public:
+	HaloExchange();
+	~HaloExchange();
+
+	/**
+	 * Agrees with the owners of the ghosts which local agents each process
+	 * sends, collective over the world
+	 */
+	void build(boost::mpi::communicator* _world,
+			const std::vector<LandAgent*>& _ghosts,
+			repast::SharedContext<LandAgent>& _agents);
+
+	/**
+	 * Posts the exchange of the local agents' actions and leaders
+	 */
+	void start();
+
+	/**
+	 * Completes the exchange and updates the ghosts
+	 */
+	void finish();
+};
+
+#endif // __HALOEXCHANGE_H__
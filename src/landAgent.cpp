@@ -1,7 +1,8 @@
 #include "landAgent.h"
 
 LandAgent::LandAgent(repast::AgentId _id, int _strategy, bool _considerTrust,
-		double _deltaTrust, double _trustThreshold) {
+		double _deltaTrust, double _trustThreshold, long long _cell,
+		const CellRandom* _random) {
 	id = _id;
 	x = 0;
 	y = 0;
@@ -25,10 +26,13 @@ LandAgent::LandAgent(repast::AgentId _id, int _strategy, bool _considerTrust,
 	payoff = 0;
 	numDefectors = 0;
 
-	genDecisionAction = repast::Random::instance()->getGenerator(
-			"decisionAction");
-	genAction = repast::Random::instance()->getGenerator("action");
-	genTrustLeader = repast::Random::instance()->getGenerator("trustLeader");
+	dirty = DIRTY_ALL;
+
+	pendingCoalition = PENDING_NONE;
+	pendingAction = false;
+
+	cell = _cell;
+	random = _random;
 }
 
 LandAgent::LandAgent(repast::AgentId _id, int _x, int _y, bool _isIndependent,
@@ -48,6 +52,14 @@ LandAgent::LandAgent(repast::AgentId _id, int _x, int _y, bool _isIndependent,
 	payoff = _payoff;
 
 	coalitionPayoff = _coalitionPayoff;
+
+	dirty = DIRTY_ALL;
+
+	pendingCoalition = PENDING_NONE;
+	pendingAction = false;
+
+	cell = 0;
+	random = 0;
 }
 
 LandAgent::~LandAgent() {
@@ -70,8 +82,11 @@ int LandAgent::getY() {
 }
 
 void LandAgent::setXY(int _x, int _y) {
-	x = _x;
-	y = _y;
+	if ((x != _x) || (y != _y)) {
+		x = _x;
+		y = _y;
+		dirty |= DIRTY_POSITION;
+	}
 }
 
 const std::vector<LandAgent*> LandAgent::getNeighbors() const {
@@ -120,7 +135,10 @@ bool LandAgent::getIsIndependent() {
 }
 
 void LandAgent::setIsIndependent(bool _isIndependent) {
-	isIndependent = _isIndependent;
+	if (isIndependent != _isIndependent) {
+		isIndependent = _isIndependent;
+		dirty |= DIRTY_STATUS;
+	}
 }
 
 bool LandAgent::getIsMember() {
@@ -128,7 +146,10 @@ bool LandAgent::getIsMember() {
 }
 
 void LandAgent::setIsMember(bool _isMember) {
-	isMember = _isMember;
+	if (isMember != _isMember) {
+		isMember = _isMember;
+		dirty |= DIRTY_STATUS;
+	}
 }
 
 bool LandAgent::getIsLeader() {
@@ -136,7 +157,10 @@ bool LandAgent::getIsLeader() {
 }
 
 void LandAgent::setIsLeader(bool _isLeader) {
-	isLeader = _isLeader;
+	if (isLeader != _isLeader) {
+		isLeader = _isLeader;
+		dirty |= DIRTY_STATUS;
+	}
 }
 
 repast::AgentId LandAgent::getLeaderId() {
@@ -144,7 +168,10 @@ repast::AgentId LandAgent::getLeaderId() {
 }
 
 void LandAgent::setLeaderId(repast::AgentId _leaderId) {
-	leaderId = _leaderId;
+	if (!(leaderId == _leaderId)) {
+		leaderId = _leaderId;
+		dirty |= DIRTY_LEADER;
+	}
 }
 
 double LandAgent::getTrustLeader() {
@@ -160,7 +187,10 @@ int LandAgent::getAction() {
 }
 
 void LandAgent::setAction(int _action) {
-	action = _action;
+	if (action != _action) {
+		action = _action;
+		dirty |= DIRTY_ACTION;
+	}
 }
 
 double LandAgent::getPayoff() {
@@ -168,7 +198,10 @@ double LandAgent::getPayoff() {
 }
 
 void LandAgent::setPayoff(double _payoff) {
-	payoff = _payoff;
+	if (payoff != _payoff) {
+		payoff = _payoff;
+		dirty |= DIRTY_PAYOFF;
+	}
 }
 
 double LandAgent::getCoalitionPayoff() {
@@ -176,11 +209,14 @@ double LandAgent::getCoalitionPayoff() {
 }
 
 void LandAgent::setCoalitionPayoff(double _coalitionPayoff) {
-	coalitionPayoff = _coalitionPayoff;
+	if (coalitionPayoff != _coalitionPayoff) {
+		coalitionPayoff = _coalitionPayoff;
+		dirty |= DIRTY_COALITION_PAYOFF;
+	}
 }
 
 void LandAgent::getCoalitionMembers(
-		std::vector<LandAgent*>& _coalitionMembers) {
+		std::vector<repast::AgentId>& _coalitionMembers) {
 	_coalitionMembers = coalitionMembers;
 }
 
@@ -192,35 +228,51 @@ void LandAgent::setNumDefectors(int _numDefectors) {
 	numDefectors = _numDefectors;
 }
 
+int LandAgent::getDirty() {
+	return dirty;
+}
+
+void LandAgent::clearDirty() {
+	dirty = 0;
+}
+
+void LandAgent::setStatus(bool _isIndependent, bool _isMember,
+		bool _isLeader) {
+	setIsIndependent(_isIndependent);
+	setIsMember(_isMember);
+	setIsLeader(_isLeader);
+}
+
 /**
  * ACTIONS PERFORMED BY THE AGENTS AT EACH SIMULATION CYCLE
  */
 
 void LandAgent::beginCycle() {
-	action = 0;
-	payoff = 0;
+	setAction(0);
+	setPayoff(0);
 
-	coalitionPayoff = 0;
+	setCoalitionPayoff(0);
 }
 
 void LandAgent::decideAction() {
 // pTFT
 	if (strategy == PTFT) {
-		if ((numDefectors / numNeighbors) > genDecisionAction->next()) {
-			action = DEFECT;
+		if ((numDefectors / numNeighbors)
+				> random->next(STREAM_DECISION_ACTION, cell)) {
+			setAction(DEFECT);
 		} else {
-			action = COOPERATE;
+			setAction(COOPERATE);
 		}
 		// TFT
 	} else if (strategy == TFT) {
 		if (numDefectors > (numNeighbors / 2)) {
-			action = DEFECT;
+			setAction(DEFECT);
 		} else {
-			action = COOPERATE;
+			setAction(COOPERATE);
 		}
 		// Random
 	} else if (strategy == RANDOM) {
-		action = (int) genAction->next();
+		setAction((int) random->next(STREAM_ACTION, cell, DRAW_DECIDE));
 	}
 }
 
@@ -230,6 +282,7 @@ void LandAgent::calculatePayoff(int _payoffT, int _payoffR, int _payoffP,
 	int numDefect = 0;
 	int numMember = 0;
 	int neighborAction = 0;
+	double value = payoff;
 	std::vector<LandAgent*>::iterator it;
 
 // Leader or Coalition Member
@@ -246,7 +299,7 @@ void LandAgent::calculatePayoff(int _payoffT, int _payoffR, int _payoffP,
 				}
 			}
 		}
-		payoff = (numMember * _payoffR) + (numCooperate * _payoffT)
+		value = (numMember * _payoffR) + (numCooperate * _payoffT)
 				+ (numDefect * _payoffP);
 	} else if (isIndependent) {
 		// Independent and Cooperated
@@ -259,7 +312,7 @@ void LandAgent::calculatePayoff(int _payoffT, int _payoffR, int _payoffP,
 					numDefect++;
 				}
 			}
-			payoff = (numCooperate * _payoffR) + (numDefect * _payoffS);
+			value = (numCooperate * _payoffR) + (numDefect * _payoffS);
 		}
 		// Independent and Defected
 		else if (action == DEFECT) {
@@ -271,29 +324,23 @@ void LandAgent::calculatePayoff(int _payoffT, int _payoffR, int _payoffP,
 					numDefect++;
 				}
 			}
-			payoff = (numCooperate * _payoffT) + (numDefect * _payoffP);
+			value = (numCooperate * _payoffT) + (numDefect * _payoffP);
 		}
 	}
 
-	payoff = payoff / (float) numNeighbors;
+	setPayoff(value / (float) numNeighbors);
 	numDefectors = numDefect;
 }
 
-void LandAgent::addCoalitionPayoff(float _payoff) {
-	coalitionPayoff += _payoff;
-}
-
-void LandAgent::calculateCoalitionPayoff(float tax) {
-	if (coalitionMembers.size() > 0) {
-		// Leader receives its payoff plus the coalition members' tax
-		payoff = payoff + (coalitionPayoff * tax);
+void LandAgent::calculateCoalitionPayoff(
+		const std::vector<std::pair<int, double> >& _contributions,
+		float tax) {
+	double leaderPayoff = payoff;
+	double share = splitCoalitionPayoff(coalitionPayoff, _contributions,
+			coalitionMembers.size(), tax, leaderPayoff);
 
-		// Members receive an even portion of the coalition's payoff
-		coalitionPayoff = (coalitionPayoff * (1.0 - tax))
-				/ (double) coalitionMembers.size();
-	} else {
-		coalitionPayoff = 0;
-	}
+	setPayoff(leaderPayoff);
+	setCoalitionPayoff(share);
 }
 
 void LandAgent::decideCoalition() {
@@ -312,17 +359,14 @@ void LandAgent::decideCoalition() {
 
 	if (isIndependent) {
 		if (worstPayoff) {
+			pendingLeaderId = leaderId;
 			if (best->getIsIndependent() || best->getIsLeader()) {
-				leaderId = best->getId();
+				pendingLeaderId = best->getId();
 			} else if (best->getIsMember()) {
-				leaderId = best->getLeaderId();
+				pendingLeaderId = best->getLeaderId();
 			}
 
-			isIndependent = false;
-			isMember = true;
-			isLeader = false;
-
-			trustLeader = genTrustLeader->next();
+			pendingCoalition = PENDING_JOIN;
 		}
 	} else if (isMember) {
 		if (considerTrust) {
@@ -330,42 +374,49 @@ void LandAgent::decideCoalition() {
 				trustLeader = std::min(0.0, (trustLeader - deltaTrust));
 
 				if (trustLeader < trustThreshold) {
-					isIndependent = true;
-					isMember = false;
-					isLeader = false;
-
-					action = (int) genAction->next();
+					pendingCoalition = PENDING_LEAVE;
 				}
 			} else {
 				trustLeader = std::max((trustLeader + deltaTrust), 1.0);
 			}
 		} else {
 			if (payoff < (best->payoff / 2.0)) {
-				isIndependent = true;
-				isMember = false;
-				isLeader = false;
-
-				action = (int) genAction->next();
+				pendingCoalition = PENDING_LEAVE;
 			}
 		}
 	}
 }
 
 void LandAgent::updateCoalitionStatus(
-		std::vector<LandAgent*> _coalitionMembers) {
+		const std::vector<repast::AgentId>& _coalitionMembers) {
 	coalitionMembers.clear();
 
 	coalitionMembers.assign(_coalitionMembers.begin(), _coalitionMembers.end());
 
 	if ((coalitionMembers.size() == 0) && (isLeader)) {
-		isIndependent = true;
-		isMember = false;
-		isLeader = false;
+		setStatus(true, false, false);
 
-		action = (int) genAction->next();
+		pendingAction = true;
 	} else if ((coalitionMembers.size() > 0) && (!isLeader)) {
-		isIndependent = false;
-		isMember = false;
-		isLeader = true;
+		setStatus(false, false, true);
+	}
+}
+
+void LandAgent::resolveDraws() {
+	if (pendingCoalition == PENDING_JOIN) {
+		setLeaderId(pendingLeaderId);
+		setStatus(false, true, false);
+
+		trustLeader = random->next(STREAM_TRUST_LEADER, cell);
+	} else if (pendingCoalition == PENDING_LEAVE) {
+		setStatus(true, false, false);
+
+		setAction((int) random->next(STREAM_ACTION, cell, DRAW_LEAVE));
+	}
+	pendingCoalition = PENDING_NONE;
+
+	if (pendingAction) {
+		setAction((int) random->next(STREAM_ACTION, cell, DRAW_DISSOLVE));
+		pendingAction = false;
 	}
 }
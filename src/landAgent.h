@@ -1,20 +1,28 @@
 #ifndef  __LANDAGENT_H__
 #define  __LANDAGENT_H__
 
+#include <boost/mpi/datatype.hpp>
+#include <boost/static_assert.hpp>
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/base_object.hpp>
+#include <boost/serialization/is_bitwise_serializable.hpp>
+#include <boost/serialization/level.hpp>
+#include <boost/serialization/tracking.hpp>
 #include <repast_hpc/AgentId.h>
-#include <repast_hpc/Random.h>
 #include <repast_hpc/SharedContext.h>
 
-// Action
-const int DEFECT = 0;
-const int COOPERATE = 1;
+#include "agentConstants.h"
+#include "cellRandom.h"
+#include "coalitionSplit.h"
 
-// Strategy
-const int PTFT = 0;
-const int TFT = 1;
-const int RANDOM = 2;
+// Replicated fields changed since the last synchronization
+const int DIRTY_POSITION = 1;
+const int DIRTY_STATUS = 2;
+const int DIRTY_LEADER = 4;
+const int DIRTY_ACTION = 8;
+const int DIRTY_PAYOFF = 16;
+const int DIRTY_COALITION_PAYOFF = 32;
+const int DIRTY_ALL = 63;
 
 class LandAgent: public repast::Agent {
 
@@ -45,21 +53,31 @@ private:
 	repast::AgentId leaderId;
 	double trustLeader;
 	double coalitionPayoff;
-	std::vector<LandAgent*> coalitionMembers;
+	std::vector<repast::AgentId> coalitionMembers;
 
 	// Agent information
 	int action;
 	double payoff;
 	int numDefectors;
 
-	// Random
-	repast::NumberGenerator* genAction;
-	repast::NumberGenerator* genDecisionAction;
-	repast::NumberGenerator* genTrustLeader;
+	// Synchronization
+	int dirty;
+
+	// Coalition decision applied once every agent has decided
+	int pendingCoalition;
+	repast::AgentId pendingLeaderId;
+	bool pendingAction;
+
+	// Random, draws are keyed by the global cell id
+	long long cell;
+	const CellRandom* random;
+
+	void setStatus(bool _isIndependent, bool _isMember, bool _isLeader);
 
 public:
 	LandAgent(repast::AgentId _id, int _strategy, bool _considerTrust,
-			double _deltaTrust, double _trustThreshold);
+			double _deltaTrust, double _trustThreshold, long long _cell,
+			const CellRandom* _random);
 
 	LandAgent(repast::AgentId _id, int _x, int _y, bool _isIndependent,
 			bool _isMember, bool _isLeader, repast::AgentId _leaderId,
@@ -117,11 +135,18 @@ public:
 	double getCoalitionPayoff();
 	void setCoalitionPayoff(double _coalitionPayoff);
 
-	void getCoalitionMembers(std::vector<LandAgent*>& _coalitionMembers);
+	void getCoalitionMembers(
+			std::vector<repast::AgentId>& _coalitionMembers);
 
 	int getNumDefectors();
 	void setNumDefectors(int _numDefectors);
 
+	/**
+	 * Replicated fields changed since the last synchronization
+	 */
+	int getDirty();
+	void clearDirty();
+
 	/**
 	 * ACTIONS PERFORMED BY THE AGENTS AT EACH SIMULATION CYCLE
 	 */
@@ -143,59 +168,76 @@ public:
 			int _payoffS);
 
 	/**
-	 * Leader agents update its coalition payoff
+	 * Calculates the coalition leader payoff from its members' contributions
+	 * (member cell, payoff) and the split for each
 	 */
-	void addCoalitionPayoff(float _payoff);
+	void calculateCoalitionPayoff(
+			const std::vector<std::pair<int, double> >& _contributions,
+			float tax);
 
 	/**
-	 * Calculates the coalition leader payoff and return the split for each
+	 * Agent decides to join/leave a coalition or stay as it is, the decision
+	 * is applied by resolveDraws so that every agent sees the same neighbors
 	 */
-	void calculateCoalitionPayoff(float tax);
+	void decideCoalition();
 
 	/**
-	 * Agent decides to join/leave a coalition or stay as it is
+	 * Agent updates its status based on the members that follow it
 	 */
-	void decideCoalition();
+	void updateCoalitionStatus(
+			const std::vector<repast::AgentId>& _coalitionMembers);
 
-	void updateCoalitionStatus(std::vector<LandAgent*> _coalitionMembers);
+	/**
+	 * Applies the pending coalition decision and takes its random draws
+	 */
+	void resolveDraws();
 };
 
+/**
+ * Fixed layout package, trivially copyable and shipped as a single MPI
+ * datatype. Fields not flagged in fields are left out of the update.
+ */
 struct LandAgentPackage {
 
 	friend class boost::serialization::access;
 
+	// Describes the layout used to build the MPI datatype
 	template<class Archive>
 	void serialize(Archive & ar, const unsigned int version) {
+		ar & payoff;
+		ar & coalitionPayoff;
 		ar & id;
 		ar & proc;
 		ar & type;
 		ar & x;
 		ar & y;
-		ar & isIndependent;
-		ar & isMember;
-		ar & isLeader;
 		ar & leaderId;
 		ar & leaderProc;
 		ar & leaderType;
 		ar & action;
-		ar & payoff;
-		ar & coalitionPayoff;
+		ar & isIndependent;
+		ar & isMember;
+		ar & isLeader;
+		ar & fields;
 	}
 
+	double payoff;
+	double coalitionPayoff;
 	int id;
 	int proc;
 	int type;
 	int x;
 	int y;
-	bool isIndependent;
-	bool isMember;
-	bool isLeader;
 	int leaderId;
 	int leaderProc;
 	int leaderType;
 	int action;
-	double payoff;
-	double coalitionPayoff;
+	char isIndependent;
+	char isMember;
+	char isLeader;
+
+	// Fields carried by the package
+	char fields;
 
 	repast::AgentId getId() const {
 		return repast::AgentId(id, proc, type);
@@ -206,6 +248,14 @@ struct LandAgentPackage {
 	}
 };
 
+BOOST_STATIC_ASSERT(sizeof(LandAgentPackage) == 56);
+
+BOOST_IS_MPI_DATATYPE(LandAgentPackage)
+BOOST_IS_BITWISE_SERIALIZABLE(LandAgentPackage)
+BOOST_CLASS_IMPLEMENTATION(LandAgentPackage,
+		boost::serialization::object_serializable)
+BOOST_CLASS_TRACKING(LandAgentPackage, boost::serialization::track_never)
+
 struct LandAgentEdge {
 
 	friend class boost::serialization::access;
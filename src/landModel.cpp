@@ -10,6 +10,23 @@ LandModel::LandModel(const std::string& _propsFile, int _argc, char** _argv,
 	rank = rp->rank();
 	world = _world;
 
+	// Phases are tracked for the times, the traffic or the trace
+	profiler.enable(repast::strToInt(props.getProperty(PROFILE_ENABLED)) == 1);
+	if (repast::strToInt(props.getProperty(PROFILE_COMM)) == 1) {
+		comm.start(*world);
+		profiler.setCounters(&comm);
+		profiler.enable(true);
+	}
+
+	int traceInterval = repast::strToInt(props.getProperty(TRACE_INTERVAL));
+	if (traceInterval > 0) {
+		tracer.start(*world, traceInterval,
+				repast::strToInt(props.getProperty(TRACE_EVENTS)));
+		profiler.setTracer(&tracer);
+		profiler.enable(true);
+	}
+	profiler.begin(PHASE_SETUP);
+
 	// Payoff information
 	payoffT = repast::strToInt(props.getProperty(PAYOFF_T));
 	payoffR = repast::strToInt(props.getProperty(PAYOFF_R));
@@ -27,10 +44,35 @@ LandModel::LandModel(const std::string& _propsFile, int _argc, char** _argv,
 	strategyType = repast::strToInt(props.getProperty(MODEL_STRATEGY_TYPE));
 	neighborhoodType = repast::strToInt(props.getProperty(MODEL_NEIGHBORHOOD));
 	topologyType = repast::strToInt(props.getProperty(MODEL_TOPOLOGY));
-
-	genStrategy = repast::Random::instance()->getGenerator("strategy");
-	genConsiderTrust = repast::Random::instance()->getGenerator(
-			"considerTrust");
+	replicationType = repast::strToInt(props.getProperty(MODEL_REPLICATION));
+	storeType = repast::strToInt(props.getProperty(MODEL_STORE));
+	exchangeType = repast::strToInt(props.getProperty(MODEL_EXCHANGE));
+
+#ifdef _OPENMP
+	// Threads per process, 0 leaves the OpenMP default
+	int threads = repast::strToInt(props.getProperty(MODEL_THREADS));
+	if (threads > 0) {
+		omp_set_num_threads(threads);
+	}
+#endif
+
+	// Same seed on every process
+	random.seed(repast::Random::instance()->seed());
+	random.setDistribution(STREAM_STRATEGY,
+			CellDistribution::parse(props.getProperty(DISTRIBUTION_STRATEGY)));
+	random.setDistribution(STREAM_CONSIDER_TRUST,
+			CellDistribution::parse(
+					props.getProperty(DISTRIBUTION_CONSIDER_TRUST)));
+	random.setDistribution(STREAM_DECISION_ACTION,
+			CellDistribution::parse(
+					props.getProperty(DISTRIBUTION_DECISION_ACTION)));
+	random.setDistribution(STREAM_ACTION,
+			CellDistribution::parse(props.getProperty(DISTRIBUTION_ACTION)));
+	random.setDistribution(STREAM_TRUST_LEADER,
+			CellDistribution::parse(
+					props.getProperty(DISTRIBUTION_TRUST_LEADER)));
+	round = 0;
+	random.setRound(round);
 
 	// Grid size
 	sizeX = repast::strToInt(props.getProperty(GRID_MAX_X))
@@ -58,38 +100,75 @@ LandModel::LandModel(const std::string& _propsFile, int _argc, char** _argv,
 	dimX = sizeX / procX;
 	dimY = sizeY / procY;
 
+	snapshots.setup(*world, props.getProperty(SNAPSHOT_DIR),
+			props.getProperty(ENSEMBLE_TASK), sizeX, sizeY,
+			repast::strToInt(props.getProperty(SNAPSHOT_DEFLATE)));
+
+	coalitionIndex.resize(dimX * dimY);
+	contributions.resize(dimX * dimY);
+
 	int originX = grid->dimensions().origin().getX();
 	int originY = grid->dimensions().origin().getY();
 
-	// Create the agents
+	deltaSync = false;
+	dataset = 0;
+
+	checkpoint.setDirectory(props.getProperty(CHECKPOINT_DIR),
+			props.getProperty(ENSEMBLE_TASK));
+	checkpointInterval = repast::strToInt(
+			props.getProperty(CHECKPOINT_INTERVAL));
+	lastCheckpoint = -1;
+
+	snapshotInterval = repast::strToInt(props.getProperty(SNAPSHOT_INTERVAL));
+
+	// Create the agents, local id i at column i / dimY and row i % dimY of
+	// the tile, which need not be square
 	int strategy = strategyType;
 	bool cTrust;
 	LandAgent* agent;
 	for (int i = 0; i < (dimX * dimY); i++) {
 		repast::AgentId id(i, rank, AGENT_TYPE);
+		int cell = ((originY + (i % dimY)) * sizeX) + originX + (i / dimY);
 
 		// Define the strategy
 		if (strategyType == 3) {
-			strategy = (int) genStrategy->next();
+			strategy = (int) random.next(STREAM_STRATEGY, cell);
 		}
 
 		// Define if the agent should consider trust
-		if (genConsiderTrust->next() <= considerTrust) {
+		if (random.next(STREAM_CONSIDER_TRUST, cell) <= considerTrust) {
 			cTrust = true;
 		} else {
 			cTrust = false;
 		}
 
-		agent = new LandAgent(id, strategy, cTrust, deltaTrust, trustThreshold);
+		agent = new LandAgent(id, strategy, cTrust, deltaTrust, trustThreshold,
+				cell, &random);
 		agents.addAgent(agent);
 
 		// Move the agent to the position in the grid
 		grid->moveTo(agent,
-				repast::Point<int>(originX + (i / dimX), originY + (i % dimY)));
-		agent->setXY((originX + (i / dimX)), (originY + (i % dimY)));
+				repast::Point<int>(originX + (i / dimY), originY + (i % dimY)));
+		agent->setXY((originX + (i / dimY)), (originY + (i % dimY)));
+	}
+
+	// Resume from the latest complete checkpoint, before any agent state is
+	// copied to other processes or to the store
+	if (repast::strToInt(props.getProperty(CHECKPOINT_RESTART)) == 1) {
+		int latest = (rank == 0) ? checkpoint.latest() : -1;
+		boost::mpi::broadcast(*world, latest, 0);
+
+		if (latest >= 0) {
+			readCheckpoint(latest);
+		} else if (rank == 0) {
+			Log4CL::instance()->get_logger("root").log(WARN,
+					"No checkpoint to restart from, starting from round 0");
+		}
 	}
 
+	profiler.begin(PHASE_BARRIER);
 	world->barrier();
+	profiler.end(PHASE_BARRIER);
 
 	rp->synchronizeProjectionInfo<LandAgent, LandAgentPackage>(agents, *this,
 			*this, *this);
@@ -97,19 +176,48 @@ LandModel::LandModel(const std::string& _propsFile, int _argc, char** _argv,
 	// Set agents neighbors
 	for (int i = 0; i < (dimX * dimY); i++) {
 		agent = grid->getObjectAt(
-				repast::Point<int>(originX + (i / dimX), originY + (i % dimY)));
+				repast::Point<int>(originX + (i / dimY), originY + (i % dimY)));
 
 		agent->setNeighbors(neighborhood(agent));
 	}
 
-	// Request agents from other processes
-	int numProcesses = repast::RepastProcess::instance()->worldSize();
+	// Coalition exchanges start with the processes of the grid neighbors
+	std::set<int> gridNeighbors;
+	for (int i = 0; i < (dimX * dimY); i++) {
+		agent = agents.getAgent(repast::AgentId(i, rank, AGENT_TYPE));
+
+		const std::vector<LandAgent*> neighbors = agent->getNeighbors();
+		for (int n = 0, size = neighbors.size(); n < size; n++) {
+			gridNeighbors.insert(neighbors[n]->getId().startingRank());
+		}
+	}
+	topology.build(*world, gridNeighbors);
+
+	if (storeType != OBJECTS) {
+		buildStore();
+	}
 
+	// Request agents from other processes
 	repast::AgentRequest request(rank);
-	for (int p = 0; p < numProcesses; p++) {
-		if (p != rank) {
-			for (int i = 0; i < (dimX * dimY); i++) {
-				request.addRequest(repast::AgentId(i, p, AGENT_TYPE));
+	if (replicationType == HALO) {
+		// Only the buffer cells
+		std::vector<LandAgent*> ghosts;
+		std::vector<LandAgent*>::iterator ghost;
+		int nAgents = 0;
+
+		agents.selectAgents(repast::SharedContext<LandAgent>::NON_LOCAL,
+				nAgents, ghosts);
+		for (ghost = ghosts.begin(); ghost != ghosts.end(); ++ghost) {
+			request.addRequest((*ghost)->getId());
+		}
+	} else {
+		int numProcesses = repast::RepastProcess::instance()->worldSize();
+
+		for (int p = 0; p < numProcesses; p++) {
+			if (p != rank) {
+				for (int i = 0; i < (dimX * dimY); i++) {
+					request.addRequest(repast::AgentId(i, p, AGENT_TYPE));
+				}
 			}
 		}
 	}
@@ -118,71 +226,143 @@ LandModel::LandModel(const std::string& _propsFile, int _argc, char** _argv,
 
 	repast::RepastProcess::instance()->synchronizeAgentStates<LandAgentPackage>(
 			*this, *this);
-}
-
-LandModel::~LandModel() {
-}
-
-void LandModel::initDataCollection() {
-	std::string outputFile = props.getProperty(OUTPUT_FILE);
-	std::string outputSeparator = props.getProperty(OUTPUT_SEPARATOR);
 
-	repast::ScheduleRunner& runner =
-			repast::RepastProcess::instance()->getScheduleRunner();
+	if (exchangeType == ACTION_BITS) {
+		// Remote neighbors of the local agents
+		std::vector<LandAgent*> localAgents;
+		std::vector<LandAgent*> ghosts;
+		std::set<LandAgent*> known;
+		int nAgents = 0;
+
+		agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
+				localAgents);
+		for (int i = 0, size = localAgents.size(); i < size; i++) {
+			const std::vector<LandAgent*> neighbors =
+					localAgents[i]->getNeighbors();
+			for (int n = 0, numNeighbors = neighbors.size(); n < numNeighbors;
+					n++) {
+				if ((neighbors[n]->getId().startingRank() != rank)
+						&& known.insert(neighbors[n]).second) {
+					ghosts.push_back(neighbors[n]);
+				}
+			}
+		}
 
-	repast::SVDataSetBuilder builder(outputFile, outputSeparator,
-			runner.schedule());
+		halo.build(world, ghosts, agents);
+	}
 
-	NumCoalitions* numCoalitionsDS = new NumCoalitions(this);
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_NUMCOALITIONS, numCoalitionsDS,
-					std::plus<int>()));
+	overlapHalo = repast::strToInt(props.getProperty(MODEL_OVERLAP)) == 1;
+	if ((overlapHalo) && (exchangeType != ACTION_BITS)) {
+		Log4CL::instance()->get_logger("root").log(WARN,
+				"Overlap needs the action bits exchange, disabled");
+		overlapHalo = false;
+	}
+	hiddenTime = 0;
+	exposedTime = 0;
+
+	if (overlapHalo) {
+		std::vector<LandAgent*> localAgents;
+		int nAgents = 0;
+
+		agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
+				localAgents);
+		for (int i = 0, size = localAgents.size(); i < size; i++) {
+			const std::vector<LandAgent*> neighbors =
+					localAgents[i]->getNeighbors();
+			bool boundary = false;
+
+			for (int n = 0, numNeighbors = neighbors.size(); n < numNeighbors;
+					n++) {
+				if (neighbors[n]->getId().startingRank() != rank) {
+					boundary = true;
+				}
+			}
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_CREATEDCOALITIONS,
-					new CreatedCoalitions(this), std::plus<int>()));
+			if (boundary) {
+				boundaryAgents.push_back(localAgents[i]);
+				boundaryCells.push_back(localAgents[i]->getId().id());
+			} else {
+				interiorAgents.push_back(localAgents[i]);
+				interiorCells.push_back(localAgents[i]->getId().id());
+			}
+		}
+	}
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_DESTROYEDCOALITIONS,
-					new DestroyedCoalitions(this), std::plus<int>()));
+	countStatus();
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_NUMINCHANGES,
-					new NumInChanges(this), std::plus<int>()));
+	// The coalition index is rebuilt from the restored leaders. Statuses were
+	// already updated against it, so this only restores the leaders' members.
+	if (round > 0) {
+		std::vector<LandAgent*> localAgents;
+		int nAgents = 0;
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_NUMOUTCHANGES,
-					new NumOutChanges(this), std::plus<int>()));
+		buildCoalitionIndex();
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_NUMAGENTSCOALITIONS,
-					new NumAgentsCoalitions(this), std::plus<int>()));
+		agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
+				localAgents);
+		for (int i = 0, size = localAgents.size(); i < size; i++) {
+			localAgents[i]->updateCoalitionStatus(
+					coalitionIndex[localAgents[i]->getId().id()]);
+		}
+	}
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_NUMAGENTSINDEPENDENT,
-					new NumAgentsIndependent(this), std::plus<int>()));
+	profiler.end(PHASE_SETUP);
+}
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_NUMINDEPENDENTPTFT,
-					new NumIndependentpTFT(this), std::plus<int>()));
+LandModel::~LandModel() {
+	delete dataset;
+}
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_NUMINDEPENDENTTFT,
-					new NumIndependentTFT(this), std::plus<int>()));
+void LandModel::initDataCollection() {
+	std::string outputFile = props.getProperty(OUTPUT_FILE);
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_NUMINDEPENDENTRANDOM,
-					new NumIndependentRandom(this), std::plus<int>()));
+	// A restarted run keeps the output written before the failure
+	if (round > 0) {
+		outputFile = suffixFile(outputFile,
+				"_from" + boost::lexical_cast<std::string>(round));
+	}
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_COALITIONPAYOFF,
-					new CoalitionPayoff(this), std::plus<double>()));
+	repast::ScheduleRunner& runner =
+			repast::RepastProcess::instance()->getScheduleRunner();
 
-	builder.addDataSource(
-			repast::createSVDataSource(FIELD_INDEPENDENTPAYOFF,
-					new IndependentPayoff(this), std::plus<double>()));
+	// Only the first process writes
+	OutputSink* sink = 0;
+	if (rank == 0) {
+		if (repast::strToInt(props.getProperty(OUTPUT_FORMAT)) == NETCDF) {
+			// Same name with the NetCDF extension
+			sink = new NetCDFSink(replaceExtension(outputFile, ".nc"),
+					repast::strToInt(props.getProperty(OUTPUT_DEFLATE)),
+					repast::strToInt(props.getProperty(OUTPUT_CHUNK)));
+		} else {
+			sink = new CSVSink(outputFile,
+					props.getProperty(OUTPUT_SEPARATOR));
+		}
+	}
 
-	dataset = builder.createDataSet();
+	OutputDataSet* output = new OutputDataSet(world, runner.schedule(), sink,
+			repast::strToInt(props.getProperty(OUTPUT_QUEUE)));
+	output->addDataSource(FIELD_NUMCOALITIONS, new NumCoalitions(this));
+	output->addDataSource(FIELD_CREATEDCOALITIONS,
+			new CreatedCoalitions(this));
+	output->addDataSource(FIELD_DESTROYEDCOALITIONS,
+			new DestroyedCoalitions(this));
+	output->addDataSource(FIELD_NUMINCHANGES, new NumInChanges(this));
+	output->addDataSource(FIELD_NUMOUTCHANGES, new NumOutChanges(this));
+	output->addDataSource(FIELD_NUMAGENTSCOALITIONS,
+			new NumAgentsCoalitions(this));
+	output->addDataSource(FIELD_NUMAGENTSINDEPENDENT,
+			new NumAgentsIndependent(this));
+	output->addDataSource(FIELD_NUMINDEPENDENTPTFT,
+			new NumIndependentpTFT(this));
+	output->addDataSource(FIELD_NUMINDEPENDENTTFT,
+			new NumIndependentTFT(this));
+	output->addDataSource(FIELD_NUMINDEPENDENTRANDOM,
+			new NumIndependentRandom(this));
+	output->addDataSource(FIELD_COALITIONPAYOFF, new CoalitionPayoff(this));
+	output->addDataSource(FIELD_INDEPENDENTPAYOFF,
+			new IndependentPayoff(this));
+
+	dataset = output;
 }
 
 void LandModel::initSchedule() {
@@ -191,29 +371,67 @@ void LandModel::initSchedule() {
 
 	runner.scheduleStop(rounds);
 
-	runner.scheduleEvent(1, 1,
+	// A restarted run resumes after the round of its checkpoint
+	double start = round + 1;
+
+	runner.scheduleEvent(start, 1,
 			repast::Schedule::FunctorPtr(
 					new repast::MethodFunctor<LandModel>(this,
 							&LandModel::step)));
 
-	runner.scheduleEvent(1.1, 1,
+	runner.scheduleEvent(start + 0.1, 1,
 			repast::Schedule::FunctorPtr(
 					new repast::MethodFunctor<LandModel>(this,
 							&LandModel::updateOutput)));
 
-	runner.scheduleEvent(1.2, 1,
+	runner.scheduleEvent(start + 0.2, 1,
 			repast::Schedule::FunctorPtr(
-					new repast::MethodFunctor<repast::DataSet>(dataset,
-							&repast::DataSet::record)));
+					new repast::MethodFunctor<LandModel>(this,
+							&LandModel::recordOutput)));
 
 	repast::Schedule::FunctorPtr dataWrite = repast::Schedule::FunctorPtr(
-			new repast::MethodFunctor<repast::DataSet>(dataset,
-					&repast::DataSet::write));
+			new repast::MethodFunctor<LandModel>(this,
+					&LandModel::writeOutput));
 
 	int flush = repast::strToInt(props.getProperty(OUTPUT_FLUSH));
-	runner.scheduleEvent(1.3, flush, dataWrite);
+	runner.scheduleEvent(start + 0.3, flush, dataWrite);
 
 	runner.scheduleEndEvent(dataWrite);
+	runner.scheduleEndEvent(
+			repast::Schedule::FunctorPtr(
+					new repast::MethodFunctor<repast::DataSet>(dataset,
+							&repast::DataSet::close)));
+
+	// On the multiples of the interval, also after a restart
+	if (snapshotInterval > 0) {
+		int first = ((round / snapshotInterval) + 1) * snapshotInterval;
+		runner.scheduleEvent(first + 0.5, snapshotInterval,
+				repast::Schedule::FunctorPtr(
+						new repast::MethodFunctor<LandModel>(this,
+								&LandModel::writeSnapshot)));
+	}
+
+	if (checkpointInterval > 0) {
+		runner.scheduleEvent(start + checkpointInterval - 1 + 0.4,
+				checkpointInterval,
+				repast::Schedule::FunctorPtr(
+						new repast::MethodFunctor<LandModel>(this,
+								&LandModel::writeCheckpoint)));
+	}
+
+	if (overlapHalo) {
+		runner.scheduleEndEvent(
+				repast::Schedule::FunctorPtr(
+						new repast::MethodFunctor<LandModel>(this,
+								&LandModel::reportOverlap)));
+	}
+
+	if (profiler.isEnabled()) {
+		runner.scheduleEndEvent(
+				repast::Schedule::FunctorPtr(
+						new repast::MethodFunctor<LandModel>(this,
+								&LandModel::reportProfile)));
+	}
 }
 
 std::vector<LandAgent*> LandModel::neighborhood(LandAgent* _agent) {
@@ -306,162 +524,941 @@ std::vector<LandAgent*> LandModel::neighborhood(LandAgent* _agent) {
 
 void LandModel::step() {
 	std::vector<LandAgent*> localAgents;
-	std::vector<LandAgent*> remoteAgents;
-	std::vector<LandAgent*>::iterator local;
-	std::vector<LandAgent*>::iterator remote;
-	LandAgent* leader;
 	int nAgents = 0;
 
-	// Decide an action
 	agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
 			localAgents);
-	for (local = localAgents.begin(); local != localAgents.end(); local++) {
-		(*local)->decideAction();
+	int numLocal = localAgents.size();
+
+	round++;
+	comm.setRound(round);
+	tracer.setTick(round);
+	random.setRound(round);
+
+	counters[COUNTER_CREATED] = 0;
+	counters[COUNTER_DESTROYED] = 0;
+	counters[COUNTER_IN] = 0;
+	counters[COUNTER_OUT] = 0;
+
+	if (overlapHalo) {
+		overlapPayoff();
+	} else {
+		// Decide an action
+		profiler.begin(PHASE_DECIDE_ACTION);
+		if (storeType != OBJECTS) {
+			store.decideAction(random);
+			scatterStore();
+		} else {
+#pragma omp parallel for schedule(static)
+			for (int i = 0; i < numLocal; i++) {
+				localAgents[i]->decideAction();
+			}
+		}
+		profiler.end(PHASE_DECIDE_ACTION);
+
+		// Buffer synchronization, the payoff only reads actions and leaders
+		profiler.begin(PHASE_EXCHANGE);
+		if (exchangeType == ACTION_BITS) {
+			halo.start();
+			halo.finish();
+		} else {
+			repast::RepastProcess::instance()->synchronizeProjectionInfo<
+					LandAgent, LandAgentPackage>(agents, *this, *this, *this);
+		}
+		profiler.end(PHASE_EXCHANGE);
+
+		// Calculate Payoff
+		profiler.begin(PHASE_PAYOFF);
+		if (storeType != OBJECTS) {
+			gatherStore(store.numLocal, store.numCells);
+			if (storeType == PLANES) {
+				planes.calculatePayoff(store, payoffT, payoffR, payoffP,
+						payoffS);
+			} else {
+				store.calculatePayoff(payoffT, payoffR, payoffP, payoffS);
+			}
+			scatterStore();
+		} else {
+#pragma omp parallel for schedule(static)
+			for (int i = 0; i < numLocal; i++) {
+				localAgents[i]->calculatePayoff(payoffT, payoffR, payoffP,
+						payoffS);
+			}
+		}
+		profiler.end(PHASE_PAYOFF);
 	}
 
-	// Buffer synchronization
-	repast::RepastProcess::instance()->synchronizeProjectionInfo<LandAgent,
-			LandAgentPackage>(agents, *this, *this, *this);
-	world->barrier();
+	// Leaders collect their members' payoff and share it back
+	profiler.begin(PHASE_LEADER_PAYOFF);
+	reduceCoalitionPayoff();
+	profiler.end(PHASE_LEADER_PAYOFF);
 
-	// Calculate Payoff
-	agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
-			localAgents);
-	for (local = localAgents.begin(); local != localAgents.end(); local++) {
-		(*local)->calculatePayoff(payoffT, payoffR, payoffP, payoffS);
+	// Synchronization
+	profiler.begin(PHASE_SYNC_PAYOFF);
+	synchronizeChanges();
+	profiler.end(PHASE_SYNC_PAYOFF);
+
+	// Independents and Members decide about the coalition
+	profiler.begin(PHASE_DECIDE_COALITION);
+	if (storeType != OBJECTS) {
+		gatherStore(0, store.numCells);
+		store.decideCoalition(random);
+		scatterStore();
+	} else {
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < numLocal; i++) {
+			if ((localAgents[i]->getIsMember())
+					|| (localAgents[i]->getIsIndependent())) {
+				localAgents[i]->decideCoalition();
+			}
+		}
+
+		int changes[NUM_COUNTERS] = { 0 };
+#pragma omp parallel for schedule(static) reduction(+:changes[:NUM_COUNTERS])
+		for (int i = 0; i < numLocal; i++) {
+			unsigned char from = statusOf(localAgents[i]);
+			localAgents[i]->resolveDraws();
+			countChange(from, statusOf(localAgents[i]),
+					localAgents[i]->getStrategy(), changes);
+		}
+
+		for (int c = 0; c < NUM_COUNTERS; c++) {
+			counters[c] += changes[c];
+		}
 	}
+	profiler.end(PHASE_DECIDE_COALITION);
 
 	// Synchronization
-	repast::RepastProcess::instance()->synchronizeAgentStates<LandAgentPackage>(
-			*this, *this, "REQUEST_AGENTS_ALL");
-	world->barrier();
+	profiler.begin(PHASE_SYNC_COALITION);
+	synchronizeChanges();
+	profiler.end(PHASE_SYNC_COALITION);
+
+	// Update coalition status
+	profiler.begin(PHASE_COALITION_INDEX);
+	buildCoalitionIndex();
+	profiler.end(PHASE_COALITION_INDEX);
+
+	profiler.begin(PHASE_COALITION_STATUS);
+
+	// Last changes of the round in a single pass, which also adds the final
+	// payoffs per fixed block so the sums do not depend on the threads
+	int numBlocks = (numLocal + OUTPUT_BLOCK - 1) / OUTPUT_BLOCK;
+	std::vector<double> coalitionBlocks(numBlocks, 0);
+	std::vector<double> independentBlocks(numBlocks, 0);
+	int changes[NUM_COUNTERS] = { 0 };
+
+#pragma omp parallel for schedule(static) reduction(+:changes[:NUM_COUNTERS])
+	for (int b = 0; b < numBlocks; b++) {
+		int last = std::min(numLocal, (b + 1) * OUTPUT_BLOCK);
+
+		for (int i = b * OUTPUT_BLOCK; i < last; i++) {
+			LandAgent* local = localAgents[i];
+			unsigned char from = statusOf(local);
+
+			local->updateCoalitionStatus(coalitionIndex[local->getId().id()]);
+			local->resolveDraws();
+
+			unsigned char to = statusOf(local);
+			countChange(from, to, local->getStrategy(), changes);
+
+			if (to == STATUS_INDEPENDENT) {
+				independentBlocks[b] += local->getPayoff();
+			} else if (to != 0) {
+				coalitionBlocks[b] += local->getPayoff();
+			}
+		}
+	}
+
+	for (int c = 0; c < NUM_COUNTERS; c++) {
+		counters[c] += changes[c];
+	}
+
+	coalitionPayoff = 0;
+	independentPayoff = 0;
+	for (int b = 0; b < numBlocks; b++) {
+		coalitionPayoff += coalitionBlocks[b];
+		independentPayoff += independentBlocks[b];
+	}
+
+	if (storeType != OBJECTS) {
+		gatherStore(0, store.numLocal);
+	}
+	profiler.end(PHASE_COALITION_STATUS);
+}
+
+void LandModel::overlapPayoff() {
+	int numBoundary = boundaryAgents.size();
+	int numInterior = interiorAgents.size();
+
+	// Neighborhoods are symmetric, the agents sent to other processes are
+	// the boundary ones
+	profiler.begin(PHASE_DECIDE_ACTION);
+	if (storeType != OBJECTS) {
+		store.decideAction(random, boundaryCells);
+		scatterStore();
+	} else {
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < numBoundary; i++) {
+			boundaryAgents[i]->decideAction();
+		}
+	}
+	profiler.end(PHASE_DECIDE_ACTION);
+
+	halo.start();
+	double posted = MPI_Wtime();
+
+	// Interior decisions are counted with the payoff they overlap with
+	profiler.begin(PHASE_PAYOFF);
+
+	// Interior agents only read local neighbors
+	if (storeType != OBJECTS) {
+		store.decideAction(random, interiorCells);
+		if (storeType != PLANES) {
+			store.calculatePayoff(payoffT, payoffR, payoffP, payoffS,
+					interiorCells);
+		}
+	} else {
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < numInterior; i++) {
+			interiorAgents[i]->decideAction();
+		}
+
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < numInterior; i++) {
+			interiorAgents[i]->calculatePayoff(payoffT, payoffR, payoffP,
+					payoffS);
+		}
+	}
+
+	profiler.end(PHASE_PAYOFF);
+
+	double computed = MPI_Wtime();
+	profiler.begin(PHASE_EXCHANGE);
+	halo.finish();
+	profiler.end(PHASE_EXCHANGE);
+	double completed = MPI_Wtime();
+
+	hiddenTime += computed - posted;
+	exposedTime += completed - computed;
+
+	// Boundary agents, the bit plane kernel covers the whole tile at once
+	profiler.begin(PHASE_PAYOFF);
+	if (storeType != OBJECTS) {
+		gatherStore(store.numLocal, store.numCells);
+		if (storeType == PLANES) {
+			planes.calculatePayoff(store, payoffT, payoffR, payoffP, payoffS);
+		} else {
+			store.calculatePayoff(payoffT, payoffR, payoffP, payoffS,
+					boundaryCells);
+		}
+		scatterStore();
+	} else {
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < numBoundary; i++) {
+			boundaryAgents[i]->calculatePayoff(payoffT, payoffR, payoffP,
+					payoffS);
+		}
+	}
+	profiler.end(PHASE_PAYOFF);
+}
+
+void LandModel::reportOverlap() {
+	double times[2] = { hiddenTime, exposedTime };
+	double totals[2] = { 0, 0 };
+
+	boost::mpi::reduce(*world, times, 2, totals, std::plus<double>(), 0);
+
+	if (rank == 0) {
+		double inFlight = totals[0] + totals[1];
+		double overlap = (inFlight > 0) ? (100.0 * totals[0]) / inFlight : 0;
+
+		Log4CL::instance()->get_logger("root").log(INFO,
+				"halo overlap: " + boost::lexical_cast<std::string>(overlap)
+						+ "% (computing "
+						+ boost::lexical_cast<std::string>(totals[0])
+						+ " s, waiting "
+						+ boost::lexical_cast<std::string>(totals[1])
+						+ " s)");
+	}
+}
+
+void LandModel::reportProfile() {
+	// The reports' own traffic is left out
+	comm.stop();
+
+	if (repast::strToInt(props.getProperty(PROFILE_ENABLED)) == 1) {
+		std::string summary = profiler.report(*world,
+				props.getProperty(PROFILE_FILE));
+
+		if (rank == 0) {
+			Log4CL::instance()->get_logger("root").log(INFO,
+					"Phase times (seconds), imbalance = max / mean - 1\n"
+							+ summary);
+		}
+	}
+
+	if (repast::strToInt(props.getProperty(PROFILE_COMM)) == 1) {
+		std::string traffic = props.getProperty(PROFILE_TRAFFIC);
+		comm.report(*world, props.getProperty(PROFILE_COMM_FILE), traffic,
+				suffixFile(traffic, "_messages"));
+	}
+
+	if ((tracer.isStarted())
+			&& (!tracer.write(*world, props.getProperty(TRACE_FILE),
+					PhaseProfiler::NAMES)) && (rank == 0)) {
+		Log4CL::instance()->get_logger("root").log(WARN,
+				"Trace " + props.getProperty(TRACE_FILE)
+						+ " could not be written");
+	}
+}
+
+void LandModel::buildStore() {
+	std::vector<LandAgent*> localAgents;
+	std::vector<LandAgent*>::iterator local;
+	std::map<LandAgent*, int> ghostSlots;
+	int nAgents = 0;
 
-	// Leaders collect their members' Payoff
-	std::vector<LandAgent*> members;
-	std::vector<LandAgent*>::iterator member;
 	agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
 			localAgents);
+	int numLocal = localAgents.size();
+
+	// Ghosts take the slots after the local agents
+	for (local = localAgents.begin(); local != localAgents.end(); local++) {
+		const std::vector<LandAgent*> neighbors = (*local)->getNeighbors();
+		for (int n = 0, size = neighbors.size(); n < size; n++) {
+			if ((neighbors[n]->getId().startingRank() != rank)
+					&& (ghostSlots.find(neighbors[n]) == ghostSlots.end())) {
+				int slot = numLocal + ghostSlots.size();
+				ghostSlots[neighbors[n]] = slot;
+			}
+		}
+	}
+
+	store.resize(numLocal, ghostSlots.size());
+	store.deltaTrust = deltaTrust;
+	store.trustThreshold = trustThreshold;
+	storeAgents.assign(store.numCells, 0);
+
+	// Local agents take the slot of their local id
 	for (local = localAgents.begin(); local != localAgents.end(); local++) {
-		if ((*local)->getIsLeader()) {
-			leader = *local;
-			leader->getCoalitionMembers(members);
-			for (member = members.begin(); member != members.end(); ++member) {
-				if ((leader->getId() == (*member)->getLeaderId())
-						&& ((*member)->getIsMember())) {
-					leader->addCoalitionPayoff((*member)->getPayoff());
+		int slot = (*local)->getId().id();
+		storeAgents[slot] = *local;
+		store.strategy[slot] = (*local)->getStrategy();
+		store.considerTrust[slot] = (*local)->getConsiderTrust();
+		store.trustLeader[slot] = (*local)->getTrustLeader();
+		store.numDefectors[slot] = (*local)->getNumDefectors();
+		store.cell[slot] = cellId(*local);
+	}
+
+	std::map<LandAgent*, int>::iterator ghost;
+	for (ghost = ghostSlots.begin(); ghost != ghostSlots.end(); ++ghost) {
+		storeAgents[ghost->second] = ghost->first;
+	}
+
+	// Neighbors index, in the order used by the agents
+	for (int i = 0; i < numLocal; i++) {
+		const std::vector<LandAgent*> neighbors =
+				storeAgents[i]->getNeighbors();
+		for (int n = 0, size = neighbors.size(); n < size; n++) {
+			if (neighbors[n]->getId().startingRank() != rank) {
+				store.neighbors.push_back(ghostSlots[neighbors[n]]);
+			} else {
+				store.neighbors.push_back(neighbors[n]->getId().id());
+			}
+		}
+		store.neighborBegin[i + 1] = store.neighbors.size();
+	}
+
+	if ((storeType == PLANES) && (!buildPlanes(ghostSlots))) {
+		Log4CL::instance()->get_logger("root").log(WARN,
+				"Local tile not fully covered, using the CSR payoff");
+		storeType = ARRAYS;
+	}
+
+	gatherStore(0, store.numCells);
+}
+
+bool LandModel::buildPlanes(const std::map<LandAgent*, int>& _ghostSlots) {
+	int originX = grid->dimensions().origin().getX();
+	int originY = grid->dimensions().origin().getY();
+	int frameWidth = dimX + 2;
+	int frameHeight = dimY + 2;
+	std::vector<int> frame(frameWidth * frameHeight, -1);
+	std::map<LandAgent*, int>::const_iterator ghost;
+
+	for (int r = 0; r < frameHeight; r++) {
+		for (int c = 0; c < frameWidth; c++) {
+			int x = originX + c - 1;
+			int y = originY + r - 1;
+			bool inside = (r > 0) && (r <= dimY) && (c > 0) && (c <= dimX);
+
+			if (topologyType == TORUS) {
+				x = (x + sizeX) % sizeX;
+				y = (y + sizeY) % sizeY;
+			} else if ((x < 0) || (x >= sizeX) || (y < 0) || (y >= sizeY)) {
+				continue;
+			}
+
+			LandAgent* agent = grid->getObjectAt(repast::Point<int>(x, y));
+			if (agent == 0) {
+				if (inside) {
+					return false;
 				}
+				continue;
 			}
+
+			if (agent->getId().startingRank() == rank) {
+				frame[(r * frameWidth) + c] = agent->getId().id();
+			} else if (inside) {
+				return false;
+			} else {
+				// Corners are not neighbors in the von Neumann neighborhood
+				ghost = _ghostSlots.find(agent);
+				if (ghost != _ghostSlots.end()) {
+					frame[(r * frameWidth) + c] = ghost->second;
+				}
+			}
+		}
+	}
+
+	planes.build(dimX, dimY, neighborhoodType == MOORE, frame);
+	return true;
+}
+
+void LandModel::gatherStore(int _begin, int _end) {
+#pragma omp parallel for schedule(static)
+	for (int i = _begin; i < _end; i++) {
+		LandAgent* agent = storeAgents[i];
+
+		store.id[i] = agentKey(agent->getId());
+		store.leader[i] = agentKey(agent->getLeaderId());
+		store.action[i] = agent->getAction();
+		store.payoff[i] = agent->getPayoff();
+
+		store.status[i] = statusOf(agent);
+	}
+}
+
+void LandModel::scatterStore() {
+	int changes[NUM_COUNTERS] = { 0 };
+
+#pragma omp parallel for schedule(static) reduction(+:changes[:NUM_COUNTERS])
+	for (int i = 0; i < store.numLocal; i++) {
+		unsigned char changed = store.changed[i];
+		if (changed == 0) {
+			continue;
 		}
+
+		LandAgent* agent = storeAgents[i];
+		if (changed & CHANGED_ACTION) {
+			agent->setAction(store.action[i]);
+		}
+		if (changed & CHANGED_PAYOFF) {
+			agent->setPayoff(store.payoff[i]);
+			agent->setNumDefectors(store.numDefectors[i]);
+		}
+		if (changed & CHANGED_STATUS) {
+			countChange(statusOf(agent), store.status[i], agent->getStrategy(),
+					changes);
+			agent->setIsIndependent(store.status[i] & STATUS_INDEPENDENT);
+			agent->setIsMember(store.status[i] & STATUS_MEMBER);
+			agent->setIsLeader(store.status[i] & STATUS_LEADER);
+		}
+		if (changed & CHANGED_LEADER) {
+			agent->setLeaderId(agentId(store.leader[i]));
+		}
+		if (changed & CHANGED_TRUST) {
+			agent->setTrustLeader(store.trustLeader[i]);
+		}
+		store.changed[i] = 0;
 	}
 
-	// Leaders calculate theirs and their members payoff
+	for (int c = 0; c < NUM_COUNTERS; c++) {
+		counters[c] += changes[c];
+	}
+}
+
+void LandModel::writeCheckpoint() {
+	std::vector<LandAgent*> localAgents;
+	int nAgents = 0;
+
+	profiler.begin(PHASE_CHECKPOINT);
+
 	agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
 			localAgents);
-	for (local = localAgents.begin(); local != localAgents.end(); local++) {
-		if ((*local)->getIsLeader()) {
-			(*local)->calculateCoalitionPayoff(tax);
+
+	std::vector<AgentCheckpoint> states(localAgents.size());
+	for (int i = 0, size = localAgents.size(); i < size; i++) {
+		LandAgent* agent = localAgents[i];
+		AgentCheckpoint& state = states[agent->getId().id()];
+
+		state.trustLeader = agent->getTrustLeader();
+		state.payoff = agent->getPayoff();
+		state.coalitionPayoff = agent->getCoalitionPayoff();
+		state.leader = agentKey(agent->getLeaderId());
+		state.id = agent->getId().id();
+		state.strategy = agent->getStrategy();
+		state.action = agent->getAction();
+		state.numDefectors = agent->getNumDefectors();
+		state.considerTrust = agent->getConsiderTrust();
+		state.isIndependent = agent->getIsIndependent();
+		state.isMember = agent->getIsMember();
+		state.isLeader = agent->getIsLeader();
+	}
+
+	CheckpointHeader header = { Checkpoint::MAGIC, Checkpoint::VERSION,
+			(uint32_t) repast::Random::instance()->seed(), round, rank,
+			world->size(), sizeX, sizeY, (int) states.size() };
+
+	// The output covers the same rounds as the checkpoint, a restart
+	// continues it from the next round
+	dataset->flush();
+
+	// Counts only if every process wrote its file
+	int written = checkpoint.write(header, states) ? 1 : 0;
+	int complete = 0;
+	boost::mpi::all_reduce(*world, written, complete,
+			boost::mpi::minimum<int>());
+
+	if (complete) {
+		if (rank == 0) {
+			checkpoint.commit(round);
+		}
+		world->barrier();
+
+		if (lastCheckpoint >= 0) {
+			checkpoint.remove(lastCheckpoint, rank);
+		}
+		lastCheckpoint = round;
+	} else {
+		checkpoint.remove(round, rank);
+		if (rank == 0) {
+			Log4CL::instance()->get_logger("root").log(WARN,
+					"Checkpoint of round "
+							+ boost::lexical_cast<std::string>(round)
+							+ " failed, keeping the previous one");
 		}
 	}
 
-	// Synchronization
-	repast::RepastProcess::instance()->synchronizeAgentStates<LandAgentPackage>(
-			*this, *this, "REQUEST_AGENTS_ALL");
-	world->barrier();
+	profiler.end(PHASE_CHECKPOINT);
+}
+
+void LandModel::writeSnapshot() {
+	std::vector<LandAgent*> localAgents;
+	int nAgents = 0;
+
+	int originX = grid->dimensions().origin().getX();
+	int originY = grid->dimensions().origin().getY();
+	int cells = dimX * dimY;
+
+	profiler.begin(PHASE_SNAPSHOT);
+
+	std::vector<unsigned char> action(cells, 0);
+	std::vector<unsigned char> status(cells, 0);
+	std::vector<long long> leader(cells, -1);
+	std::vector<double> payoff(cells, 0);
 
-	// Members collect their payoff
 	agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
 			localAgents);
-	for (local = localAgents.begin(); local != localAgents.end(); local++) {
-		if ((*local)->getIsMember()) {
-			leader = agents.getAgent((*local)->getLeaderId());
-			(*local)->setPayoff(leader->getCoalitionPayoff());
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int) localAgents.size(); i++) {
+		LandAgent* agent = localAgents[i];
+		int cell = ((agent->getY() - originY) * dimX)
+				+ (agent->getX() - originX);
+
+		action[cell] = agent->getAction();
+		payoff[cell] = agent->getPayoff();
+
+		// Leaders are their own leader, independents have none
+		if (agent->getIsLeader()) {
+			status[cell] = STATUS_LEADER;
+			leader[cell] = agentKey(agent->getId());
+		} else if (agent->getIsMember()) {
+			status[cell] = STATUS_MEMBER;
+			leader[cell] = agentKey(agent->getLeaderId());
+		} else if (agent->getIsIndependent()) {
+			status[cell] = STATUS_INDEPENDENT;
 		}
 	}
 
-	// Synchronization
-	repast::RepastProcess::instance()->synchronizeAgentStates<LandAgentPackage>(
-			*this, *this, "REQUEST_AGENTS_ALL");
-	world->barrier();
+	if ((!snapshots.write(round, originX, originY, dimX, dimY, action,
+			status, leader, payoff)) && (rank == 0)) {
+		Log4CL::instance()->get_logger("root").log(WARN,
+				"Snapshot of round " + boost::lexical_cast<std::string>(round)
+						+ " could not be written");
+	}
+
+	profiler.end(PHASE_SNAPSHOT);
+}
+
+void LandModel::readCheckpoint(int _round) {
+	CheckpointHeader header;
+	std::vector<AgentCheckpoint> states;
+
+	checkpoint.read(_round, rank, header, states);
+
+	if ((header.round != _round) || (header.rank != rank)
+			|| (header.worldSize != world->size()) || (header.sizeX != sizeX)
+			|| (header.sizeY != sizeY) || (header.numAgents != (dimX * dimY))
+			|| (header.seed
+					!= (uint32_t) repast::Random::instance()->seed())) {
+		throw std::runtime_error(
+				"Checkpoint of round "
+						+ boost::lexical_cast<std::string>(_round)
+						+ " does not match the grid, processes or seed");
+	}
+
+	for (int i = 0, size = states.size(); i < size; i++) {
+		const AgentCheckpoint& state = states[i];
+		LandAgent* agent = agents.getAgent(
+				repast::AgentId(state.id, rank, AGENT_TYPE));
+
+		agent->setStrategy(state.strategy);
+		agent->setConsiderTrust(state.considerTrust);
+		agent->setIsIndependent(state.isIndependent);
+		agent->setIsMember(state.isMember);
+		agent->setIsLeader(state.isLeader);
+		agent->setLeaderId(agentId(state.leader));
+		agent->setTrustLeader(state.trustLeader);
+		agent->setAction(state.action);
+		agent->setPayoff(state.payoff);
+		agent->setCoalitionPayoff(state.coalitionPayoff);
+		agent->setNumDefectors(state.numDefectors);
+		agent->clearDirty();
+	}
+
+	// Draws are keyed by round, nothing else of the generator to restore
+	round = _round;
+	random.setRound(round);
+	lastCheckpoint = _round;
+}
+
+void LandModel::reduceCoalitionPayoff() {
+	std::vector<LandAgent*> localAgents;
+	std::vector<LeaderPayoff>::iterator entry;
+	LandAgent* leader;
+	int nAgents = 0;
+
+	// Indexed by neighbor, the topology holds every remote leader's process
+	// since the last coalition index
+	const std::vector<int>& neighbors = topology.getNeighbors();
+	std::vector<std::vector<LeaderPayoff> > outgoing(neighbors.size());
+	std::vector<std::vector<LeaderPayoff> > incoming;
 
-	// Independents and Members decide about the coalition
 	agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
 			localAgents);
-	for (local = localAgents.begin(); local != localAgents.end(); local++) {
-		if (((*local)->getIsMember()) || ((*local)->getIsIndependent())) {
-			(*local)->decideCoalition();
+	int numLocal = localAgents.size();
+
+	// Members of remote leaders send their payoff to the leader's process
+	for (int i = 0; i < numLocal; i++) {
+		if (localAgents[i]->getIsMember()) {
+			repast::AgentId leaderId = localAgents[i]->getLeaderId();
+
+			if (leaderId.startingRank() != rank) {
+				LeaderPayoff contribution = { leaderId.id(),
+						cellId(localAgents[i]), localAgents[i]->getPayoff() };
+				outgoing[topology.indexOf(leaderId.startingRank())].push_back(
+						contribution);
+			}
 		}
 	}
 
-	// Synchronization
+	topology.exchange(outgoing, incoming);
+
+	for (int p = 0, size = incoming.size(); p < size; p++) {
+		for (entry = incoming[p].begin(); entry != incoming[p].end();
+				++entry) {
+			contributions[entry->leader].push_back(
+					std::make_pair(entry->member, entry->payoff));
+		}
+	}
+
+	// Leaders collect their local members' payoff, found through the index
+	// built last round, and calculate theirs and their members payoff
+#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < numLocal; i++) {
+		LandAgent* local = localAgents[i];
+		std::vector<std::pair<int, double> >& payoffs =
+				contributions[local->getId().id()];
+
+		if (local->getIsLeader()) {
+			const std::vector<repast::AgentId>& members =
+					coalitionIndex[local->getId().id()];
+			for (int m = 0, size = members.size(); m < size; m++) {
+				if (members[m].startingRank() == rank) {
+					LandAgent* member = agents.getAgent(members[m]);
+					if ((member->getIsMember())
+							&& (member->getLeaderId() == local->getId())) {
+						payoffs.push_back(
+								std::make_pair(cellId(member),
+										member->getPayoff()));
+					}
+				}
+			}
+
+			std::sort(payoffs.begin(), payoffs.end());
+			local->calculateCoalitionPayoff(payoffs, tax);
+		}
+
+		payoffs.clear();
+	}
+
+	// Shares go back only to the processes hosting members
+	std::vector<std::vector<LeaderPayoff> > shares(neighbors.size());
+	std::vector<std::vector<LeaderPayoff> > received;
+	for (int p = 0, size = incoming.size(); p < size; p++) {
+		std::set<int> sent;
+		for (entry = incoming[p].begin(); entry != incoming[p].end();
+				++entry) {
+			if (sent.insert(entry->leader).second) {
+				leader = agents.getAgent(
+						repast::AgentId(entry->leader, rank, AGENT_TYPE));
+				LeaderPayoff share = { entry->leader, 0,
+						leader->getCoalitionPayoff() };
+				shares[p].push_back(share);
+			}
+		}
+	}
+
+	topology.exchange(shares, received);
+
+	// Remote shares keyed by (leader process, leader local id)
+	std::map<std::pair<int, int>, double> remoteShares;
+	for (int k = 0, size = received.size(); k < size; k++) {
+		for (entry = received[k].begin(); entry != received[k].end();
+				++entry) {
+			remoteShares[std::make_pair(neighbors[k], entry->leader)] =
+					entry->payoff;
+		}
+	}
+
+	// Members collect their payoff
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < numLocal; i++) {
+		LandAgent* local = localAgents[i];
+		if (local->getIsMember()) {
+			repast::AgentId leaderId = local->getLeaderId();
+
+			if (leaderId.startingRank() == rank) {
+				local->setPayoff(
+						agents.getAgent(leaderId)->getCoalitionPayoff());
+			} else {
+				std::map<std::pair<int, int>, double>::const_iterator share =
+						remoteShares.find(
+								std::make_pair(leaderId.startingRank(),
+										leaderId.id()));
+				local->setPayoff(
+						(share != remoteShares.end()) ? share->second : 0);
+			}
+		}
+	}
+}
+
+void LandModel::synchronizeChanges() {
+	std::vector<LandAgent*> localAgents;
+	std::vector<LandAgent*>::iterator local;
+	int nAgents = 0;
+
+	deltaSync = true;
 	repast::RepastProcess::instance()->synchronizeAgentStates<LandAgentPackage>(
 			*this, *this, "REQUEST_AGENTS_ALL");
-	world->barrier();
+	deltaSync = false;
 
-	// Update coalition status
+	// Every process requesting an agent has received its changes
 	agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
 			localAgents);
 	for (local = localAgents.begin(); local != localAgents.end(); local++) {
+		(*local)->clearDirty();
+	}
+}
 
-		members.clear();
-		agents.selectAgents(repast::SharedContext<LandAgent>::NON_LOCAL,
-				nAgents, remoteAgents);
-		for (remote = remoteAgents.begin(); remote != remoteAgents.end();
-				remote++) {
-
-			if (((*local)->getId() != (*remote)->getId())
-					&& ((*local)->getId() == (*remote)->getLeaderId())
-					&& ((*remote)->getIsMember())) {
-				members.push_back(*remote);
+void LandModel::buildCoalitionIndex() {
+	std::vector<LandAgent*> localAgents;
+	std::vector<LandAgent*>::iterator local;
+	int nAgents = 0;
+
+	for (int i = 0, size = coalitionIndex.size(); i < size; i++) {
+		coalitionIndex[i].clear();
+	}
+
+	agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
+			localAgents);
+
+	// Processes of the remote leaders join the topology
+	std::set<int> peers;
+	for (local = localAgents.begin(); local != localAgents.end(); local++) {
+		if ((*local)->getIsMember()) {
+			peers.insert((*local)->getLeaderId().startingRank());
+		}
+	}
+	topology.update(peers);
+
+	// (leader local id, member local id) pairs for each remote leader process
+	const std::vector<int>& neighbors = topology.getNeighbors();
+	std::vector<std::vector<int> > outgoing(neighbors.size());
+	std::vector<std::vector<int> > incoming;
+
+	for (local = localAgents.begin(); local != localAgents.end(); local++) {
+		if ((*local)->getIsMember()) {
+			repast::AgentId leaderId = (*local)->getLeaderId();
+
+			if (leaderId == (*local)->getId()) {
+				continue;
+			}
+
+			// Agents never move, so the starting rank is the owner rank
+			if (leaderId.startingRank() == rank) {
+				coalitionIndex[leaderId.id()].push_back((*local)->getId());
+			} else {
+				int k = topology.indexOf(leaderId.startingRank());
+				outgoing[k].push_back(leaderId.id());
+				outgoing[k].push_back((*local)->getId().id());
 			}
 		}
+	}
+
+	topology.exchange(outgoing, incoming);
 
-		(*local)->updateCoalitionStatus(members);
+	for (int k = 0, size = incoming.size(); k < size; k++) {
+		for (int i = 0, pairs = incoming[k].size(); i < pairs; i += 2) {
+			coalitionIndex[incoming[k][i]].push_back(
+					repast::AgentId(incoming[k][i + 1], neighbors[k],
+							AGENT_TYPE));
+		}
 	}
 }
 
 void LandModel::updateOutput() {
+	// Counters are kept by the status changes and the payoffs added by the
+	// last pass of the step
+	numCoalitions = counters[COUNTER_LEADERS];
+	createdCoalitions = counters[COUNTER_CREATED];
+	destroyedCoalitions = counters[COUNTER_DESTROYED];
+	numInChanges = counters[COUNTER_IN];
+	numOutChanges = counters[COUNTER_OUT];
+	numAgentsCoalitions = counters[COUNTER_LEADERS]
+			+ counters[COUNTER_MEMBERS];
+	numAgentsIndependent = counters[COUNTER_INDEPENDENT];
+	numIndependentpTFT = counters[COUNTER_INDEPENDENT_STRATEGY + PTFT];
+	numIndependentTFT = counters[COUNTER_INDEPENDENT_STRATEGY + TFT];
+	numIndependentRandom = counters[COUNTER_INDEPENDENT_STRATEGY + RANDOM];
+}
+
+void LandModel::recordOutput() {
+	profiler.begin(PHASE_RECORD);
+	dataset->record();
+	profiler.end(PHASE_RECORD);
+}
+
+void LandModel::writeOutput() {
+	profiler.begin(PHASE_WRITE);
+	dataset->write();
+	profiler.end(PHASE_WRITE);
+}
+
+void LandModel::countStatus() {
 	std::vector<LandAgent*> localAgents;
-	std::vector<LandAgent*>::iterator local;
 	int nAgents = 0;
 
-	numCoalitions = 0;
-	createdCoalitions = 0;
-	destroyedCoalitions = 0;
-	numInChanges = 0;
-	numOutChanges = 0;
-	numAgentsCoalitions = 0;
-	numAgentsIndependent = 0;
-	numIndependentpTFT = 0;
-	numIndependentTFT = 0;
-	numIndependentRandom = 0;
-	coalitionPayoff = 0;
-	independentPayoff = 0;
+	for (int c = 0; c < NUM_COUNTERS; c++) {
+		counters[c] = 0;
+	}
 
 	agents.selectAgents(repast::SharedContext<LandAgent>::LOCAL, nAgents,
 			localAgents);
-	for (local = localAgents.begin(); local != localAgents.end(); local++) {
-		if ((*local)->getIsLeader()) {
-			numCoalitions++;
-			numAgentsCoalitions++;
-			coalitionPayoff += (*local)->getPayoff();
-		} else if ((*local)->getIsMember()) {
-			numAgentsCoalitions++;
-			coalitionPayoff += (*local)->getPayoff();
-		} else if ((*local)->getIsIndependent()) {
-			numAgentsIndependent++;
-
-			int strategy = (*local)->getStrategy();
-			if (strategy == PTFT) {
-				numIndependentpTFT++;
-			} else if (strategy == TFT) {
-				numIndependentTFT++;
-			} else if (strategy == RANDOM) {
-				numIndependentRandom++;
-			}
+	for (int i = 0, size = localAgents.size(); i < size; i++) {
+		countChange(0, statusOf(localAgents[i]), localAgents[i]->getStrategy(),
+				counters);
+	}
 
-			independentPayoff += (*local)->getPayoff();
-		}
+	// Agents entering the count are not changes of a round
+	counters[COUNTER_CREATED] = 0;
+	counters[COUNTER_IN] = 0;
+}
+
+void LandModel::countChange(unsigned char _from, unsigned char _to,
+		int _strategy, int* _counters) {
+	if (_from == _to) {
+		return;
+	}
+
+	if (_to == STATUS_LEADER) {
+		_counters[COUNTER_CREATED]++;
+	} else if (_from == STATUS_LEADER) {
+		_counters[COUNTER_DESTROYED]++;
+	}
+
+	if ((_from == STATUS_INDEPENDENT) && (_to == STATUS_MEMBER)) {
+		_counters[COUNTER_IN]++;
+	} else if ((_from == STATUS_MEMBER) && (_to == STATUS_INDEPENDENT)) {
+		_counters[COUNTER_OUT]++;
+	}
+
+	if (_from == STATUS_LEADER) {
+		_counters[COUNTER_LEADERS]--;
+	} else if (_from == STATUS_MEMBER) {
+		_counters[COUNTER_MEMBERS]--;
+	} else if (_from == STATUS_INDEPENDENT) {
+		_counters[COUNTER_INDEPENDENT]--;
+		_counters[COUNTER_INDEPENDENT_STRATEGY + _strategy]--;
+	}
+
+	if (_to == STATUS_LEADER) {
+		_counters[COUNTER_LEADERS]++;
+	} else if (_to == STATUS_MEMBER) {
+		_counters[COUNTER_MEMBERS]++;
+	} else if (_to == STATUS_INDEPENDENT) {
+		_counters[COUNTER_INDEPENDENT]++;
+		_counters[COUNTER_INDEPENDENT_STRATEGY + _strategy]++;
+	}
+}
+
+unsigned char LandModel::statusOf(LandAgent* _agent) {
+	if (_agent->getIsLeader()) {
+		return STATUS_LEADER;
+	} else if (_agent->getIsMember()) {
+		return STATUS_MEMBER;
+	} else if (_agent->getIsIndependent()) {
+		return STATUS_INDEPENDENT;
+	}
+	return 0;
+}
+
+int LandModel::cellId(LandAgent* _agent) {
+	return (_agent->getY() * sizeX) + _agent->getX();
+}
+
+long long LandModel::agentKey(const repast::AgentId& _id) {
+	return ((long long) _id.startingRank() << 32)
+			| (unsigned int) _id.id();
+}
+
+repast::AgentId LandModel::agentId(long long _key) {
+	return repast::AgentId((int) (_key & 0xffffffff), (int) (_key >> 32),
+			AGENT_TYPE);
+}
+
+std::string::size_type LandModel::extensionOf(const std::string& _file) {
+	std::string::size_type dot = _file.find_last_of('.');
+	std::string::size_type slash = _file.find_last_of('/');
+
+	if ((dot == std::string::npos)
+			|| ((slash != std::string::npos) && (dot < slash))) {
+		return _file.size();
 	}
+	return dot;
+}
+
+std::string LandModel::suffixFile(const std::string& _file,
+		const std::string& _suffix) {
+	std::string::size_type dot = extensionOf(_file);
+	return _file.substr(0, dot) + _suffix + _file.substr(dot);
+}
+
+std::string LandModel::replaceExtension(const std::string& _file,
+		const std::string& _extension) {
+	return _file.substr(0, extensionOf(_file)) + _extension;
 }
 
 /**
@@ -535,6 +1532,8 @@ LandAgent* LandModel::createAgent(const LandAgentPackage& content) {
 void LandModel::createAgents(std::vector<LandAgentPackage>& contents,
 		std::vector<LandAgent*>& out) {
 
+	comm.addReceivedPackages(contents.size());
+
 	std::vector<LandAgentPackage>::iterator agent;
 	for (agent = contents.begin(); agent != contents.end(); ++agent) {
 		out.push_back(
@@ -548,49 +1547,84 @@ void LandModel::createAgents(std::vector<LandAgentPackage>& contents,
 void LandModel::provideContent(LandAgent* agent,
 		std::vector<LandAgentPackage>& out) {
 
-	LandAgentPackage package = { agent->getId().id(),
-			agent->getId().startingRank(), agent->getId().agentType(),
-			agent->getX(), agent->getY(), agent->getIsIndependent(),
-			agent->getIsMember(), agent->getIsLeader(),
-			agent->getLeaderId().id(), agent->getLeaderId().startingRank(),
-			agent->getLeaderId().agentType(), agent->getAction(),
-			agent->getPayoff(), agent->getCoalitionPayoff() };
-	out.push_back(package);
+	packAgent(agent, DIRTY_ALL, out);
+	comm.addSentPackages(1);
 }
 
 void LandModel::provideContent(const repast::AgentRequest& request,
 		std::vector<LandAgentPackage>& out) {
 
 	const std::vector<repast::AgentId>& ids = request.requestedAgents();
+	size_t provided = out.size();
 	for (int i = 0, size = ids.size(); i < size; i++) {
 		repast::AgentId id = ids[i];
 
 		if (agents.contains(id)) {
 			LandAgent* agent = agents.getAgent(id);
-			LandAgentPackage content = { id.id(), id.startingRank(),
-					id.agentType(), agent->getX(), agent->getY(),
-					agent->getIsIndependent(), agent->getIsMember(),
-					agent->getIsLeader(), agent->getLeaderId().id(),
-					agent->getLeaderId().startingRank(),
-					agent->getLeaderId().agentType(), agent->getAction(),
-					agent->getPayoff(), agent->getCoalitionPayoff() };
-			out.push_back(content);
+
+			// Unchanged agents are left out of a delta synchronization
+			int fields = deltaSync ? agent->getDirty() : DIRTY_ALL;
+			if (fields == 0) {
+				continue;
+			}
+
+			packAgent(agent, fields, out);
 		}
 	}
+	comm.addSentPackages(out.size() - provided);
+}
+
+void LandModel::packAgent(LandAgent* _agent, int _fields,
+		std::vector<LandAgentPackage>& _out) {
+	const repast::AgentId& id = _agent->getId();
+	repast::AgentId leaderId = _agent->getLeaderId();
+
+	// Filled in place, the package is shipped as is
+	_out.resize(_out.size() + 1);
+	LandAgentPackage& package = _out.back();
+	package.payoff = _agent->getPayoff();
+	package.coalitionPayoff = _agent->getCoalitionPayoff();
+	package.id = id.id();
+	package.proc = id.startingRank();
+	package.type = id.agentType();
+	package.x = _agent->getX();
+	package.y = _agent->getY();
+	package.leaderId = leaderId.id();
+	package.leaderProc = leaderId.startingRank();
+	package.leaderType = leaderId.agentType();
+	package.action = _agent->getAction();
+	package.isIndependent = _agent->getIsIndependent();
+	package.isMember = _agent->getIsMember();
+	package.isLeader = _agent->getIsLeader();
+	package.fields = _fields;
 }
 
 void LandModel::updateAgent(const LandAgentPackage& content) {
 	repast::AgentId id = content.getId();
 
+	comm.addReceivedPackages(1);
+
 	if (agents.contains(id)) {
 		LandAgent* copy = agents.getAgent(id);
-		copy->setXY(content.x, content.y);
-		copy->setIsIndependent(content.isIndependent);
-		copy->setIsMember(content.isMember);
-		copy->setIsLeader(content.isLeader);
-		copy->setLeaderId(content.getLeaderId());
-		copy->setAction(content.action);
-		copy->setPayoff(content.payoff);
-		copy->setCoalitionPayoff(content.coalitionPayoff);
+		if (content.fields & DIRTY_POSITION) {
+			copy->setXY(content.x, content.y);
+		}
+		if (content.fields & DIRTY_STATUS) {
+			copy->setIsIndependent(content.isIndependent);
+			copy->setIsMember(content.isMember);
+			copy->setIsLeader(content.isLeader);
+		}
+		if (content.fields & DIRTY_LEADER) {
+			copy->setLeaderId(content.getLeaderId());
+		}
+		if (content.fields & DIRTY_ACTION) {
+			copy->setAction(content.action);
+		}
+		if (content.fields & DIRTY_PAYOFF) {
+			copy->setPayoff(content.payoff);
+		}
+		if (content.fields & DIRTY_COALITION_PAYOFF) {
+			copy->setCoalitionPayoff(content.coalitionPayoff);
+		}
 	}
 }
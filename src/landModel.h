@@ -1,6 +1,17 @@
 #ifndef  __MODEL_H__
 #define  __MODEL_H__
 
+#include <algorithm>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <boost/mpi/collectives.hpp>
+#include <boost/serialization/vector.hpp>
 #include <repast_hpc/AgentId.h>
 #include <repast_hpc/AgentRequest.h>
 //#include <repast_hpc/GridDimensions.h>
@@ -13,11 +24,49 @@
 #include <repast_hpc/SharedContext.h>
 #include <repast_hpc/SharedDiscreteSpace.h>
 #include <repast_hpc/SharedSpaces.h>
-#include <repast_hpc/SVDataSetBuilder.h>
 #include <repast_hpc/Utilities.h>
 
+#include "agentStore.h"
+#include "checkpoint.h"
+#include "commCounters.h"
 #include "dataSources.h"
+#include "haloExchange.h"
 #include "landAgent.h"
+#include "neighborTopology.h"
+#include "outputDataSet.h"
+#include "payoffPlanes.h"
+#include "phaseProfiler.h"
+#include "snapshotWriter.h"
+
+// Random distributions
+const std::string DISTRIBUTION_STRATEGY = "distribution.strategy";
+const std::string DISTRIBUTION_CONSIDER_TRUST = "distribution.considerTrust";
+const std::string DISTRIBUTION_DECISION_ACTION =
+		"distribution.decisionAction";
+const std::string DISTRIBUTION_ACTION = "distribution.action";
+const std::string DISTRIBUTION_TRUST_LEADER = "distribution.trustLeader";
+
+// Random seed, replicates of an ensemble add their number to it
+const std::string RANDOM_SEED = "random.seed";
+
+// Ensemble of replicates run by groups of proc.per.x * proc.per.y processes
+const std::string ENSEMBLE_REPLICATES = "ensemble.replicates";
+// Set for every task of an ensemble or a sweep, suffixes the names of the
+// files the task writes into shared directories
+const std::string ENSEMBLE_TASK = "ensemble.task";
+
+// Parameter sweep, sweep.<key> gives the values of <key> to run
+const std::string SWEEP_PREFIX = "sweep.";
+
+// Checkpoints every interval rounds (0 = none), restart from the latest
+const std::string CHECKPOINT_INTERVAL = "checkpoint.interval";
+const std::string CHECKPOINT_DIR = "checkpoint.dir";
+const std::string CHECKPOINT_RESTART = "checkpoint.restart";
+
+// Snapshots of the grid every interval rounds (0 = none)
+const std::string SNAPSHOT_INTERVAL = "snapshot.interval";
+const std::string SNAPSHOT_DIR = "snapshot.dir";
+const std::string SNAPSHOT_DEFLATE = "snapshot.deflate";
 
 // Grid definition
 const std::string GRID_MIN_X = "grid.min.x";
@@ -45,11 +94,32 @@ const std::string MODEL_TRUST_THRESHOLD = "model.trust-threshold";
 const std::string MODEL_STRATEGY_TYPE = "model.strategy-type";
 const std::string MODEL_NEIGHBORHOOD = "model.neighborhood";
 const std::string MODEL_TOPOLOGY = "model.topology";
+const std::string MODEL_REPLICATION = "model.replication";
+const std::string MODEL_STORE = "model.store";
+const std::string MODEL_EXCHANGE = "model.exchange";
+const std::string MODEL_THREADS = "model.threads";
+const std::string MODEL_OVERLAP = "model.overlap";
 
 // Output attributes
 const std::string OUTPUT_FILE = "output.file";
 const std::string OUTPUT_SEPARATOR = "output.separator";
 const std::string OUTPUT_FLUSH = "output.flush";
+const std::string OUTPUT_FORMAT = "output.format";
+const std::string OUTPUT_DEFLATE = "output.deflate";
+const std::string OUTPUT_CHUNK = "output.chunk";
+const std::string OUTPUT_QUEUE = "output.queue";
+
+// Profile attributes
+const std::string PROFILE_ENABLED = "profile.enabled";
+const std::string PROFILE_FILE = "profile.file";
+const std::string PROFILE_COMM = "profile.comm";
+const std::string PROFILE_COMM_FILE = "profile.comm.file";
+const std::string PROFILE_TRAFFIC = "profile.traffic";
+
+// Trace attributes
+const std::string TRACE_INTERVAL = "trace.interval";
+const std::string TRACE_EVENTS = "trace.events";
+const std::string TRACE_FILE = "trace.file";
 
 // Output
 const std::string FIELD_NUMCOALITIONS = "numCoalitions";
@@ -73,9 +143,58 @@ const int MOORE = 1;
 const int GRID = 0;
 const int TORUS = 1;
 
+// Replication
+const int FULL = 0;
+const int HALO = 1;
+
+// Store
+const int OBJECTS = 0;
+const int ARRAYS = 1;
+const int PLANES = 2;
+
+// Exchange
+const int PROJECTION = 0;
+const int ACTION_BITS = 1;
+
+// Output format
+const int CSV = 0;
+const int NETCDF = 1;
+
+// Status changes of the round
+const int COUNTER_CREATED = 0;
+const int COUNTER_DESTROYED = 1;
+const int COUNTER_IN = 2;
+const int COUNTER_OUT = 3;
+
+// Local agents by status, independents also by strategy
+const int COUNTER_LEADERS = 4;
+const int COUNTER_MEMBERS = 5;
+const int COUNTER_INDEPENDENT = 6;
+const int COUNTER_INDEPENDENT_STRATEGY = 7;
+const int NUM_COUNTERS = 10;
+
+// Agents per block of the output payoff sums
+const int OUTPUT_BLOCK = 1024;
+
 // Agent Type
 const int AGENT_TYPE = 0;
 
+// Payoff exchanged with the process of a leader
+struct LeaderPayoff {
+
+	template<class Archive>
+	void serialize(Archive & ar, const unsigned int version) {
+		ar & leader;
+		ar & member;
+		ar & payoff;
+	}
+
+	// Leader local id and member global cell id
+	int leader;
+	int member;
+	double payoff;
+};
+
 class ProviderReceiver;
 
 class LandModel {
@@ -109,6 +228,9 @@ private:
 	int strategyType;
 	int neighborhoodType;
 	int topologyType;
+	int replicationType;
+	int storeType;
+	int exchangeType;
 
 	// Output information
 	int numCoalitions;
@@ -124,18 +246,168 @@ private:
 	double coalitionPayoff;
 	double independentPayoff;
 
+	// Kept up to date at every status change
+	int counters[NUM_COUNTERS];
+
 	// General
 	repast::SharedContext<LandAgent> agents;
 	repast::SharedSpaces<LandAgent>::SharedWrappedDiscreteSpace* grid;
 	repast::Properties props;
-	repast::DataSet* dataset;
+	OutputDataSet* dataset;
+
+	// Random, draws keyed by (cell, round, stream)
+	CellRandom random;
+	int round;
+
+	// Array store and the agent held by each of its slots
+	AgentStore store;
+	std::vector<LandAgent*> storeAgents;
+	PayoffPlanes planes;
+
+	// Processes exchanging coalition payoffs and members
+	NeighborTopology topology;
 
-	// Random
-	repast::NumberGenerator* genStrategy;
-	repast::NumberGenerator* genConsiderTrust;
+	// Buffer exchange of the decide action phase
+	HaloExchange halo;
+
+	// Interior agents are computed while the exchange is in flight, boundary
+	// agents (with remote neighbors) before and after it
+	bool overlapHalo;
+	std::vector<LandAgent*> boundaryAgents;
+	std::vector<LandAgent*> interiorAgents;
+	std::vector<int> boundaryCells;
+	std::vector<int> interiorCells;
+
+	// Seconds computing while the exchange was in flight, and waiting for it
+	double hiddenTime;
+	double exposedTime;
+
+	// Coalition members of each local leader, indexed by the leader local id
+	std::vector<std::vector<repast::AgentId> > coalitionIndex;
+
+	// (member cell, payoff) contributions of each local leader, added in
+	// member order so that the sum does not depend on the decomposition
+	std::vector<std::vector<std::pair<int, double> > > contributions;
+
+	// Only changed agents and fields are provided while set
+	bool deltaSync;
+
+	// Round of the last checkpoint written, -1 if none
+	Checkpoint checkpoint;
+	int checkpointInterval;
+	int lastCheckpoint;
+
+	// Grid snapshots
+	SnapshotWriter snapshots;
+	int snapshotInterval;
+
+	// Time of each phase of the step, the traffic and the timeline of each
+	// phase
+	PhaseProfiler profiler;
+	CommCounters comm;
+	PhaseTracer tracer;
 
 	std::vector<LandAgent*> neighborhood(LandAgent* _agent);
 
+	/**
+	 * Global cell id of an agent, the key of its random draws
+	 */
+	int cellId(LandAgent* _agent);
+
+	/**
+	 * Builds the leader -> members index in a single pass over the local
+	 * agents, shipping ids of remote leaders' members to their process
+	 */
+	void buildCoalitionIndex();
+
+	/**
+	 * Synchronizes the agents' states shipping only the agents and fields
+	 * changed since the last synchronization
+	 */
+	void synchronizeChanges();
+
+	/**
+	 * Decides the actions and calculates the payoffs, overlapping the
+	 * buffer exchange with the interior agents
+	 */
+	void overlapPayoff();
+
+	/**
+	 * Logs the share of the exchange time hidden behind computation
+	 */
+	void reportOverlap();
+
+	/**
+	 * Writes the time of each phase on each process and logs the imbalance
+	 * between processes, then the traffic of each phase and between each
+	 * pair of processes and the trace
+	 */
+	void reportProfile();
+
+	/**
+	 * Counts the local agents by status, once at the start
+	 */
+	void countStatus();
+
+	/**
+	 * Adds a status change of an agent to the counters
+	 */
+	static void countChange(unsigned char _from, unsigned char _to,
+			int _strategy, int* _counters);
+
+	/**
+	 * Status of an agent as a STATUS_* flag
+	 */
+	static unsigned char statusOf(LandAgent* _agent);
+
+	/**
+	 * Position of the extension of a file name, its length if it has none
+	 */
+	static std::string::size_type extensionOf(const std::string& _file);
+
+	/**
+	 * Lays out the local and ghost agents in the array store
+	 */
+	void buildStore();
+
+	/**
+	 * Lays out the local tile and its ghost ring for the bit plane payoff,
+	 * returns false if the tile is not fully covered by local agents
+	 */
+	bool buildPlanes(const std::map<LandAgent*, int>& _ghostSlots);
+
+	/**
+	 * Copies the agents' state into the store slots [_begin, _end)
+	 */
+	void gatherStore(int _begin, int _end);
+
+	/**
+	 * Copies the fields changed in the store back into the local agents
+	 */
+	void scatterStore();
+
+	/**
+	 * Writes the local agents' state, scheduled every checkpoint interval
+	 */
+	void writeCheckpoint();
+
+	/**
+	 * Writes the action, status, leader and payoff of the local tile into
+	 * the snapshot of the round
+	 */
+	void writeSnapshot();
+
+	/**
+	 * Restores the local agents' state and the round of a checkpoint
+	 */
+	void readCheckpoint(int _round);
+
+	/**
+	 * Members send their payoff to the leader's process, leaders split the
+	 * coalition payoff and send the share back to the members' processes
+	 */
+	void reduceCoalitionPayoff();
+
 public:
 	LandModel(const std::string& propsFile, int argc, char* argv[],
 			boost::mpi::communicator* world);
@@ -144,6 +416,26 @@ public:
 	void initSchedule();
 	void step();
 	void updateOutput();
+	void recordOutput();
+	void writeOutput();
+
+	/**
+	 * Agent keys used by the array store
+	 */
+	static long long agentKey(const repast::AgentId& _id);
+	static repast::AgentId agentId(long long _key);
+
+	/**
+	 * File name with a suffix inserted before the extension
+	 */
+	static std::string suffixFile(const std::string& _file,
+			const std::string& _suffix);
+
+	/**
+	 * File name with its extension, if any, replaced by the given one
+	 */
+	static std::string replaceExtension(const std::string& _file,
+			const std::string& _extension);
 
 	/**
 	 * Output methods
@@ -172,6 +464,12 @@ public:
 	void provideContent(const repast::AgentRequest& _request,
 			std::vector<LandAgentPackage>& _out);
 	void updateAgent(const LandAgentPackage& _content);
+
+	/**
+	 * Fills a package with the agent's state
+	 */
+	void packAgent(LandAgent* _agent, int _fields,
+			std::vector<LandAgentPackage>& _out);
 };
 
 #endif // __MODEL_H__
@@ -0,0 +1,111 @@
+#include "neighborTopology.h"
+
+#include <algorithm>
+
+NeighborTopology::NeighborTopology() {
+	world = MPI_COMM_NULL;
+	graph = MPI_COMM_NULL;
+	rank = 0;
+}
+
+NeighborTopology::~NeighborTopology() {
+	int finalized = 0;
+
+	MPI_Finalized(&finalized);
+	if ((!finalized) && (graph != MPI_COMM_NULL)) {
+		MPI_Comm_free(&graph);
+	}
+}
+
+void NeighborTopology::build(MPI_Comm _world, const std::set<int>& _base) {
+	world = _world;
+	MPI_Comm_rank(world, &rank);
+
+	base.clear();
+	for (std::set<int>::const_iterator p = _base.begin(); p != _base.end();
+			++p) {
+		if (*p != rank) {
+			base.push_back(*p);
+		}
+	}
+
+	create(base);
+}
+
+bool NeighborTopology::update(const std::set<int>& _peers) {
+	std::set<int> desired(base.begin(), base.end());
+	for (std::set<int>::const_iterator p = _peers.begin(); p != _peers.end();
+			++p) {
+		if (*p != rank) {
+			desired.insert(*p);
+		}
+	}
+
+	int grown = std::includes(neighbors.begin(), neighbors.end(),
+			desired.begin(), desired.end()) ? 0 : 1;
+	int rebuild = 0;
+	MPI_Allreduce(&grown, &rebuild, 1, MPI_INT, MPI_MAX, world);
+
+	if (rebuild) {
+		// Current neighbors are kept unless mostly stale, coalitions come and
+		// go and every rebuild is collective
+		if (neighbors.size() <= (2 * desired.size())) {
+			desired.insert(neighbors.begin(), neighbors.end());
+		}
+		create(std::vector<int>(desired.begin(), desired.end()));
+	}
+	return rebuild != 0;
+}
+
+void NeighborTopology::create(const std::vector<int>& _wanted) {
+	if (graph != MPI_COMM_NULL) {
+		MPI_Comm_free(&graph);
+	}
+
+	// Each process declares the edges it wants, the incoming edges tell it
+	// which processes want to talk to it
+	MPI_Comm directed;
+	int degree = _wanted.size();
+	int unused = 0;
+	std::vector<int> destinations(_wanted);
+	destinations.push_back(unused);
+	MPI_Dist_graph_create(world, 1, &rank, &degree, &destinations[0],
+			MPI_UNWEIGHTED, MPI_INFO_NULL, 0, &directed);
+
+	int inDegree = 0;
+	int outDegree = 0;
+	int weighted = 0;
+	MPI_Dist_graph_neighbors_count(directed, &inDegree, &outDegree,
+			&weighted);
+
+	std::vector<int> sources(inDegree + 1);
+	std::vector<int> targets(outDegree + 1);
+	MPI_Dist_graph_neighbors(directed, inDegree, &sources[0], MPI_UNWEIGHTED,
+			outDegree, &targets[0], MPI_UNWEIGHTED);
+	MPI_Comm_free(&directed);
+
+	// Both directions, so that every exchange is symmetric
+	std::set<int> all(sources.begin(), sources.begin() + inDegree);
+	all.insert(targets.begin(), targets.begin() + outDegree);
+	neighbors.assign(all.begin(), all.end());
+
+	position.clear();
+	for (int k = 0, size = neighbors.size(); k < size; k++) {
+		position[neighbors[k]] = k;
+	}
+
+	int numNeighbors = neighbors.size();
+	MPI_Dist_graph_create_adjacent(world, numNeighbors,
+			numNeighbors ? &neighbors[0] : &unused, MPI_UNWEIGHTED,
+			numNeighbors, numNeighbors ? &neighbors[0] : &unused,
+			MPI_UNWEIGHTED, MPI_INFO_NULL, 0, &graph);
+}
+
+const std::vector<int>& NeighborTopology::getNeighbors() const {
+	return neighbors;
+}
+
+int NeighborTopology::indexOf(int _rank) const {
+	std::map<int, int>::const_iterator found = position.find(_rank);
+	return (found != position.end()) ? found->second : -1;
+}
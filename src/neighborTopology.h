@@ -0,0 +1,104 @@
+#ifndef  __NEIGHBORTOPOLOGY_H__
+#define  __NEIGHBORTOPOLOGY_H__
+
+#include <cstring>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <mpi.h>
+
+/**
+ * Distributed graph of the processes exchanging coalition data: the grid
+ * neighbors plus the processes linked by coalitions. Exchanges are sparse
+ * neighborhood all-to-alls, so their cost grows with the number of
+ * neighbors instead of the number of processes.
+ */
+class NeighborTopology {
+
+private:
+	MPI_Comm world;
+	MPI_Comm graph;
+	int rank;
+
+	// Grid neighbors, always part of the graph
+	std::vector<int> base;
+
+	// Symmetric neighbors of the graph and their position
+	std::vector<int> neighbors;
+	std::map<int, int> position;
+
+	void create(const std::vector<int>& _wanted);
+
+public:
+	NeighborTopology();
+	~NeighborTopology();
+
+	/**
+	 * Builds the graph of the grid neighbors, collective over the world
+	 */
+	void build(MPI_Comm _world, const std::set<int>& _base);
+
+	/**
+	 * Rebuilds the graph if any process needs a peer it does not have,
+	 * collective over the world. Returns true if the graph was rebuilt.
+	 */
+	bool update(const std::set<int>& _peers);
+
+	const std::vector<int>& getNeighbors() const;
+
+	/**
+	 * Position of a process among the neighbors, -1 if not a neighbor
+	 */
+	int indexOf(int _rank) const;
+
+	/**
+	 * Sparse all-to-all of trivially copyable elements, indexed by neighbor
+	 * position
+	 */
+	template<class T>
+	void exchange(const std::vector<std::vector<T> >& _outgoing,
+			std::vector<std::vector<T> >& _incoming) {
+		int degree = neighbors.size();
+		std::vector<int> sendCounts(degree + 1, 0);
+		std::vector<int> sendDispls(degree + 1, 0);
+		std::vector<int> recvCounts(degree + 1, 0);
+		std::vector<int> recvDispls(degree + 1, 0);
+
+		for (int k = 0; k < degree; k++) {
+			sendCounts[k] = _outgoing[k].size() * sizeof(T);
+			sendDispls[k + 1] = sendDispls[k] + sendCounts[k];
+		}
+
+		std::vector<char> sendBuffer(sendDispls[degree] + 1);
+		for (int k = 0; k < degree; k++) {
+			if (sendCounts[k] > 0) {
+				std::memcpy(&sendBuffer[sendDispls[k]], &_outgoing[k][0],
+						sendCounts[k]);
+			}
+		}
+
+		MPI_Neighbor_alltoall(&sendCounts[0], 1, MPI_INT, &recvCounts[0], 1,
+				MPI_INT, graph);
+
+		for (int k = 0; k < degree; k++) {
+			recvDispls[k + 1] = recvDispls[k] + recvCounts[k];
+		}
+
+		std::vector<char> recvBuffer(recvDispls[degree] + 1);
+		MPI_Neighbor_alltoallv(&sendBuffer[0], &sendCounts[0], &sendDispls[0],
+				MPI_BYTE, &recvBuffer[0], &recvCounts[0], &recvDispls[0],
+				MPI_BYTE, graph);
+
+		_incoming.assign(degree, std::vector<T>());
+		for (int k = 0; k < degree; k++) {
+			_incoming[k].resize(recvCounts[k] / sizeof(T));
+			if (recvCounts[k] > 0) {
+				std::memcpy(&_incoming[k][0], &recvBuffer[recvDispls[k]],
+						recvCounts[k]);
+			}
+		}
+	}
+};
+
+#endif // __NEIGHBORTOPOLOGY_H__
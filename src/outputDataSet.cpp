@@ -0,0 +1,129 @@
+#include "outputDataSet.h"
+
+#include <boost/mpi/collectives.hpp>
+
+OutputDataSet::OutputDataSet(boost::mpi::communicator* _world,
+		const repast::Schedule& _schedule, OutputSink* _sink, int _queue) :
+		world(_world), schedule(_schedule), sink(_sink) {
+	writer = 0;
+	queue = _queue;
+	closed = false;
+}
+
+OutputDataSet::~OutputDataSet() {
+	if (writer != 0) {
+		delete writer;
+	} else {
+		delete sink;
+	}
+
+	for (int s = 0, size = intSources.size(); s < size; s++) {
+		delete intSources[s];
+	}
+	for (int s = 0, size = doubleSources.size(); s < size; s++) {
+		delete doubleSources[s];
+	}
+}
+
+void OutputDataSet::addDataSource(const std::string& _name,
+		repast::TDataSource<int>* _source) {
+	intNames.push_back(_name);
+	intSources.push_back(_source);
+}
+
+void OutputDataSet::addDataSource(const std::string& _name,
+		repast::TDataSource<double>* _source) {
+	doubleNames.push_back(_name);
+	doubleSources.push_back(_source);
+}
+
+void OutputDataSet::record() {
+	records.ticks.push_back(schedule.getCurrentTick());
+
+	for (int s = 0, size = intSources.size(); s < size; s++) {
+		records.ints.push_back(intSources[s]->getData());
+	}
+	for (int s = 0, size = doubleSources.size(); s < size; s++) {
+		records.doubles.push_back(doubleSources[s]->getData());
+	}
+}
+
+void OutputDataSet::write() {
+	if ((closed) || (records.ticks.empty())) {
+		return;
+	}
+
+	// Every process records at the same ticks, the whole batch goes in a
+	// single reduction. Counts are exact as doubles up to 2^53.
+	size_t numRecords = records.ticks.size();
+	size_t numInts = intSources.size();
+	size_t numDoubles = doubleSources.size();
+	size_t width = numInts + numDoubles;
+
+	std::vector<double> packed(numRecords * width + 1);
+	for (size_t r = 0; r < numRecords; r++) {
+		double* record = &packed[r * width];
+		for (size_t v = 0; v < numInts; v++) {
+			record[v] = records.ints[(r * numInts) + v];
+		}
+		for (size_t v = 0; v < numDoubles; v++) {
+			record[numInts + v] = records.doubles[(r * numDoubles) + v];
+		}
+	}
+
+	std::vector<double> sums(packed.size());
+	boost::mpi::reduce(*world, &packed[0], packed.size(), &sums[0],
+			std::plus<double>(), 0);
+
+	OutputBatch totals;
+	totals.ints.resize(records.ints.size());
+	totals.doubles.resize(records.doubles.size());
+	for (size_t r = 0; r < numRecords; r++) {
+		const double* record = &sums[r * width];
+		for (size_t v = 0; v < numInts; v++) {
+			totals.ints[(r * numInts) + v] = (int) record[v];
+		}
+		for (size_t v = 0; v < numDoubles; v++) {
+			totals.doubles[(r * numDoubles) + v] = record[numInts + v];
+		}
+	}
+
+	if (world->rank() == 0) {
+		if (writer == 0) {
+			sink->setFields(intNames, doubleNames);
+			writer = new AsyncWriter(sink, queue);
+		}
+
+		totals.ticks.swap(records.ticks);
+		writer->push(totals);
+	}
+
+	records.ticks.clear();
+	records.ints.clear();
+	records.doubles.clear();
+}
+
+void OutputDataSet::flush() {
+	write();
+
+	if ((world->rank() == 0) && (writer != 0)) {
+		writer->drain();
+	}
+}
+
+void OutputDataSet::close() {
+	if (closed) {
+		return;
+	}
+
+	write();
+	closed = true;
+
+	if (world->rank() == 0) {
+		if (writer == 0) {
+			sink->setFields(intNames, doubleNames);
+			writer = new AsyncWriter(sink, queue);
+		}
+		writer->close();
+	}
+}
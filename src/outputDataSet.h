@@ -0,0 +1,78 @@
+#ifndef  __OUTPUTDATASET_H__
+#define  __OUTPUTDATASET_H__
+
+#include <string>
+#include <vector>
+
+#include <boost/mpi/communicator.hpp>
+#include <repast_hpc/DataSet.h>
+#include <repast_hpc/Schedule.h>
+#include <repast_hpc/TDataSource.h>
+
+#include "asyncWriter.h"
+#include "outputSink.h"
+
+/**
+ * Data set of fields summed over the processes. Each process buffers its
+ * records between writes, a write sums the whole batch of every field in a
+ * single reduction and the first process queues it to a background writer,
+ * so the next rounds run while the file is written.
+ */
+class OutputDataSet: public repast::DataSet {
+
+private:
+	boost::mpi::communicator* world;
+	const repast::Schedule& schedule;
+
+	std::vector<std::string> intNames;
+	std::vector<repast::TDataSource<int>*> intSources;
+	std::vector<std::string> doubleNames;
+	std::vector<repast::TDataSource<double>*> doubleSources;
+
+	// Records since the last write
+	OutputBatch records;
+
+	// Only on the first process, started by the first write
+	OutputSink* sink;
+	AsyncWriter* writer;
+	int queue;
+	bool closed;
+
+public:
+	/**
+	 * Takes ownership of the sink, which is only used on the first process.
+	 * At most queue batches wait to be written.
+	 */
+	OutputDataSet(boost::mpi::communicator* _world,
+			const repast::Schedule& _schedule, OutputSink* _sink, int _queue);
+	virtual ~OutputDataSet();
+
+	/**
+	 * Takes ownership of the source
+	 */
+	void addDataSource(const std::string& _name,
+			repast::TDataSource<int>* _source);
+	void addDataSource(const std::string& _name,
+			repast::TDataSource<double>* _source);
+
+	void record();
+
+	/**
+	 * Collective, reduces the records since the last write and queues them,
+	 * one reduction per output.flush ticks
+	 */
+	void write();
+
+	/**
+	 * Collective, writes the records since the last write and waits until
+	 * they are in the file
+	 */
+	void flush();
+
+	/**
+	 * Collective, writes the remaining records and waits for the writer
+	 */
+	void close();
+};
+
+#endif // __OUTPUTDATASET_H__
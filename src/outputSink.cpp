@@ -0,0 +1,165 @@
+#include "outputSink.h"
+
+#include <stdexcept>
+
+#include <netcdf.h>
+
+OutputSink::~OutputSink() {
+}
+
+void OutputSink::setFields(const std::vector<std::string>& _intNames,
+		const std::vector<std::string>& _doubleNames) {
+	intNames = _intNames;
+	doubleNames = _doubleNames;
+}
+
+CSVSink::CSVSink(const std::string& _file, const std::string& _separator) :
+		file(_file), separator(_separator) {
+	opened = false;
+}
+
+CSVSink::~CSVSink() {
+}
+
+void CSVSink::check(const std::string& _action) {
+	if (!out) {
+		throw std::runtime_error("Cannot " + _action + " output: " + file);
+	}
+}
+
+void CSVSink::write(const OutputBatch& _batch) {
+	int numInts = intNames.size();
+	int numDoubles = doubleNames.size();
+
+	if (!opened) {
+		out.open(file.c_str(), std::ios::trunc);
+		check("open");
+
+		out << "tick";
+		for (int v = 0; v < numInts; v++) {
+			out << separator << intNames[v];
+		}
+		for (int v = 0; v < numDoubles; v++) {
+			out << separator << doubleNames[v];
+		}
+		out << std::endl;
+		opened = true;
+	}
+
+	for (size_t r = 0, records = _batch.ticks.size(); r < records; r++) {
+		out << _batch.ticks[r];
+		for (int v = 0; v < numInts; v++) {
+			out << separator << _batch.ints[(r * numInts) + v];
+		}
+		for (int v = 0; v < numDoubles; v++) {
+			out << separator << _batch.doubles[(r * numDoubles) + v];
+		}
+		out << "\n";
+	}
+	out.flush();
+	check("write");
+}
+
+void CSVSink::close() {
+	if (!opened) {
+		write(OutputBatch());
+	}
+	out.close();
+	check("close");
+}
+
+NetCDFSink::NetCDFSink(const std::string& _file, int _deflate, int _chunk) :
+		file(_file) {
+	deflate = _deflate;
+	chunk = (_chunk > 0) ? _chunk : 1;
+	ncid = -1;
+	tickVar = -1;
+	written = 0;
+}
+
+NetCDFSink::~NetCDFSink() {
+}
+
+void NetCDFSink::check(int _status) {
+	if (_status != NC_NOERR) {
+		throw std::runtime_error(file + ": " + nc_strerror(_status));
+	}
+}
+
+void NetCDFSink::open() {
+	int tickDim = 0;
+
+	check(nc_create(file.c_str(), NC_NETCDF4 | NC_CLOBBER, &ncid));
+	check(nc_def_dim(ncid, "tick", NC_UNLIMITED, &tickDim));
+
+	check(nc_def_var(ncid, "tick", NC_DOUBLE, 1, &tickDim, &tickVar));
+	check(nc_def_var_chunking(ncid, tickVar, NC_CHUNKED, &chunk));
+
+	intVars.resize(intNames.size());
+	for (int v = 0, size = intNames.size(); v < size; v++) {
+		check(nc_def_var(ncid, intNames[v].c_str(), NC_INT, 1, &tickDim,
+				&intVars[v]));
+		check(nc_def_var_chunking(ncid, intVars[v], NC_CHUNKED, &chunk));
+		if (deflate > 0) {
+			check(nc_def_var_deflate(ncid, intVars[v], 1, 1, deflate));
+		}
+	}
+
+	doubleVars.resize(doubleNames.size());
+	for (int v = 0, size = doubleNames.size(); v < size; v++) {
+		check(nc_def_var(ncid, doubleNames[v].c_str(), NC_DOUBLE, 1, &tickDim,
+				&doubleVars[v]));
+		check(nc_def_var_chunking(ncid, doubleVars[v], NC_CHUNKED, &chunk));
+		if (deflate > 0) {
+			check(nc_def_var_deflate(ncid, doubleVars[v], 1, 1, deflate));
+		}
+	}
+
+	check(nc_enddef(ncid));
+}
+
+void NetCDFSink::write(const OutputBatch& _batch) {
+	size_t records = _batch.ticks.size();
+
+	if (ncid < 0) {
+		open();
+	}
+	if (records == 0) {
+		return;
+	}
+
+	size_t start = written;
+	size_t count = records;
+	check(nc_put_vara_double(ncid, tickVar, &start, &count,
+			&_batch.ticks[0]));
+
+	// Variables are written as columns of the record major batch
+	std::vector<int> intColumn(records);
+	for (int v = 0, size = intVars.size(); v < size; v++) {
+		for (size_t r = 0; r < records; r++) {
+			intColumn[r] = _batch.ints[(r * size) + v];
+		}
+		check(nc_put_vara_int(ncid, intVars[v], &start, &count,
+				&intColumn[0]));
+	}
+
+	std::vector<double> doubleColumn(records);
+	for (int v = 0, size = doubleVars.size(); v < size; v++) {
+		for (size_t r = 0; r < records; r++) {
+			doubleColumn[r] = _batch.doubles[(r * size) + v];
+		}
+		check(nc_put_vara_double(ncid, doubleVars[v], &start, &count,
+				&doubleColumn[0]));
+	}
+
+	check(nc_sync(ncid));
+	written += records;
+}
+
+void NetCDFSink::close() {
+	if (ncid < 0) {
+		open();
+	}
+	check(nc_close(ncid));
+	ncid = -1;
+}
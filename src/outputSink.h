@@ -0,0 +1,87 @@
+#ifndef  __OUTPUTSINK_H__
+#define  __OUTPUTSINK_H__
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Records summed over the processes, record major
+ */
+struct OutputBatch {
+	std::vector<double> ticks;
+	std::vector<int> ints;
+	std::vector<double> doubles;
+};
+
+/**
+ * File format of the output. Fields are set once before the first batch,
+ * batches may then be written from another thread.
+ */
+class OutputSink {
+
+protected:
+	std::vector<std::string> intNames;
+	std::vector<std::string> doubleNames;
+
+public:
+	virtual ~OutputSink();
+
+	void setFields(const std::vector<std::string>& _intNames,
+			const std::vector<std::string>& _doubleNames);
+
+	virtual void write(const OutputBatch& _batch) = 0;
+	virtual void close() = 0;
+};
+
+/**
+ * Separated values, a header line and a line per tick
+ */
+class CSVSink: public OutputSink {
+
+private:
+	std::string file;
+	std::string separator;
+	std::ofstream out;
+	bool opened;
+
+	void check(const std::string& _action);
+
+public:
+	CSVSink(const std::string& _file, const std::string& _separator);
+	~CSVSink();
+
+	void write(const OutputBatch& _batch);
+	void close();
+};
+
+/**
+ * NetCDF-4 file, one typed variable per field along the unlimited tick
+ * dimension. Deflate level 0 leaves the variables uncompressed, chunks hold
+ * the given number of ticks.
+ */
+class NetCDFSink: public OutputSink {
+
+private:
+	std::string file;
+	int deflate;
+	size_t chunk;
+
+	int ncid;
+	int tickVar;
+	std::vector<int> intVars;
+	std::vector<int> doubleVars;
+	size_t written;
+
+	void open();
+	void check(int _status);
+
+public:
+	NetCDFSink(const std::string& _file, int _deflate, int _chunk);
+	~NetCDFSink();
+
+	void write(const OutputBatch& _batch);
+	void close();
+};
+
+#endif // __OUTPUTSINK_H__
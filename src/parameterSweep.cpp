@@ -0,0 +1,92 @@
+#include "parameterSweep.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+ParameterSweep::ParameterSweep() {
+}
+
+ParameterSweep::~ParameterSweep() {
+}
+
+std::vector<std::string> ParameterSweep::parse(
+		const std::string& _definition) {
+	std::vector<std::string> result;
+
+	if (_definition.find(':') != std::string::npos) {
+		std::istringstream in(_definition);
+		double from = 0;
+		double to = 0;
+		double step = 0;
+		char separator1 = 0;
+		char separator2 = 0;
+
+		in >> from >> separator1 >> to >> separator2 >> step;
+		if ((!in) || (separator1 != ':') || (separator2 != ':')
+				|| (step <= 0) || (to < from)) {
+			throw std::invalid_argument("Invalid sweep range: " + _definition);
+		}
+
+		// Tolerance so that the end of the range survives rounding
+		int count = (int) std::floor(((to - from) / step) + 1e-9) + 1;
+		for (int i = 0; i < count; i++) {
+			std::ostringstream out;
+			out.precision(12);
+			out << (from + (i * step));
+			result.push_back(out.str());
+		}
+	} else {
+		std::istringstream in(_definition);
+		std::string value;
+
+		while (std::getline(in, value, ',')) {
+			value.erase(0, value.find_first_not_of(" \t"));
+			value.erase(value.find_last_not_of(" \t") + 1);
+			if (value.empty()) {
+				throw std::invalid_argument(
+						"Invalid sweep list: " + _definition);
+			}
+			result.push_back(value);
+		}
+	}
+
+	if (result.empty()) {
+		throw std::invalid_argument("Empty sweep: " + _definition);
+	}
+	return result;
+}
+
+void ParameterSweep::add(const std::string& _key,
+		const std::string& _definition) {
+	keys.push_back(_key);
+	values.push_back(parse(_definition));
+}
+
+bool ParameterSweep::empty() const {
+	return keys.empty();
+}
+
+const std::vector<std::string>& ParameterSweep::getKeys() const {
+	return keys;
+}
+
+int ParameterSweep::numPoints() const {
+	int points = 1;
+	for (int k = 0, size = values.size(); k < size; k++) {
+		points *= values[k].size();
+	}
+	return points;
+}
+
+std::vector<std::pair<std::string, std::string> > ParameterSweep::point(
+		int _index) const {
+	std::vector<std::pair<std::string, std::string> > result(keys.size());
+
+	for (int k = keys.size() - 1; k >= 0; k--) {
+		int size = values[k].size();
+		result[k] = std::make_pair(keys[k], values[k][_index % size]);
+		_index /= size;
+	}
+	return result;
+}
@@ -0,0 +1,46 @@
+#ifndef  __PARAMETERSWEEP_H__
+#define  __PARAMETERSWEEP_H__
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Grid of parameter points given by sweep.<key> properties, each one either
+ * a range "from:to:step" or a list "a, b, c" of values of <key>. Points are
+ * the cartesian product of the values, the last key varying fastest.
+ */
+class ParameterSweep {
+
+private:
+	std::vector<std::string> keys;
+	std::vector<std::vector<std::string> > values;
+
+	static std::vector<std::string> parse(const std::string& _definition);
+
+public:
+	ParameterSweep();
+	~ParameterSweep();
+
+	/**
+	 * Adds the values of a swept key, throws std::invalid_argument if the
+	 * definition is neither a range nor a list
+	 */
+	void add(const std::string& _key, const std::string& _definition);
+
+	bool empty() const;
+
+	const std::vector<std::string>& getKeys() const;
+
+	/**
+	 * Number of points, 1 if nothing is swept
+	 */
+	int numPoints() const;
+
+	/**
+	 * Values of the swept keys at a point, in the order of the keys
+	 */
+	std::vector<std::pair<std::string, std::string> > point(int _index) const;
+};
+
+#endif // __PARAMETERSWEEP_H__
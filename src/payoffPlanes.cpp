@@ -0,0 +1,297 @@
+#include "payoffPlanes.h"
+
+#include "agentConstants.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Lanes of 64 bit words processed at once by the bit-sliced adders
+ */
+#if defined(__AVX512F__)
+typedef __m512i Lane;
+static const int LANE_WORDS = 8;
+
+static inline Lane laneZero() {
+	return _mm512_setzero_si512();
+}
+static inline Lane laneLoad(const uint64_t* _words) {
+	return _mm512_loadu_si512(_words);
+}
+static inline void laneStore(uint64_t* _words, Lane _lane) {
+	_mm512_storeu_si512(_words, _lane);
+}
+static inline Lane laneAnd(Lane _a, Lane _b) {
+	return _mm512_and_si512(_a, _b);
+}
+static inline Lane laneOr(Lane _a, Lane _b) {
+	return _mm512_or_si512(_a, _b);
+}
+static inline Lane laneXor(Lane _a, Lane _b) {
+	return _mm512_xor_si512(_a, _b);
+}
+#elif defined(__AVX2__)
+typedef __m256i Lane;
+static const int LANE_WORDS = 4;
+
+static inline Lane laneZero() {
+	return _mm256_setzero_si256();
+}
+static inline Lane laneLoad(const uint64_t* _words) {
+	return _mm256_loadu_si256((const __m256i *) _words);
+}
+static inline void laneStore(uint64_t* _words, Lane _lane) {
+	_mm256_storeu_si256((__m256i *) _words, _lane);
+}
+static inline Lane laneAnd(Lane _a, Lane _b) {
+	return _mm256_and_si256(_a, _b);
+}
+static inline Lane laneOr(Lane _a, Lane _b) {
+	return _mm256_or_si256(_a, _b);
+}
+static inline Lane laneXor(Lane _a, Lane _b) {
+	return _mm256_xor_si256(_a, _b);
+}
+#else
+typedef uint64_t Lane;
+static const int LANE_WORDS = 1;
+
+static inline Lane laneZero() {
+	return 0;
+}
+static inline Lane laneLoad(const uint64_t* _words) {
+	return *_words;
+}
+static inline void laneStore(uint64_t* _words, Lane _lane) {
+	*_words = _lane;
+}
+static inline Lane laneAnd(Lane _a, Lane _b) {
+	return _a & _b;
+}
+static inline Lane laneOr(Lane _a, Lane _b) {
+	return _a | _b;
+}
+static inline Lane laneXor(Lane _a, Lane _b) {
+	return _a ^ _b;
+}
+#endif
+
+PayoffPlanes::PayoffPlanes() {
+	width = 0;
+	height = 0;
+	frameWidth = 0;
+	frameHeight = 0;
+	rowWords = 0;
+	moore = false;
+}
+
+PayoffPlanes::~PayoffPlanes() {
+}
+
+void PayoffPlanes::build(int _width, int _height, bool _moore,
+		const std::vector<int>& _frame) {
+	width = _width;
+	height = _height;
+	frameWidth = _width + 2;
+	frameHeight = _height + 2;
+	moore = _moore;
+	frame = _frame;
+
+	// Rows padded to whole lanes
+	rowWords = (frameWidth + 63) / 64;
+	rowWords = ((rowWords + LANE_WORDS - 1) / LANE_WORDS) * LANE_WORDS;
+
+	int words = frameHeight * rowWords;
+	coopLeft.assign(words, 0);
+	coopCenter.assign(words, 0);
+	coopRight.assign(words, 0);
+	defectLeft.assign(words, 0);
+	defectCenter.assign(words, 0);
+	defectRight.assign(words, 0);
+
+	leaderFrame.assign(frameWidth * frameHeight, 0);
+	validFrame.assign(frameWidth * frameHeight, 0);
+}
+
+void PayoffPlanes::packRow(const AgentStore& _store, int _row) {
+	uint64_t* coop = &coopCenter[_row * rowWords];
+	uint64_t* defect = &defectCenter[_row * rowWords];
+
+	for (int w = 0; w < rowWords; w++) {
+		coop[w] = 0;
+		defect[w] = 0;
+	}
+
+	for (int c = 0; c < frameWidth; c++) {
+		int f = (_row * frameWidth) + c;
+		int slot = frame[f];
+
+		if (slot >= 0) {
+			int action = _store.action[slot];
+			coop[c >> 6] |= (uint64_t) (action == COOPERATE) << (c & 63);
+			defect[c >> 6] |= (uint64_t) (action == DEFECT) << (c & 63);
+			leaderFrame[f] = _store.leader[slot];
+			validFrame[f] = 1;
+		} else {
+			leaderFrame[f] = 0;
+			validFrame[f] = 0;
+		}
+	}
+
+	// Bit c of the left plane holds column c - 1, of the right one c + 1
+	for (int w = 0; w < rowWords; w++) {
+		int i = (_row * rowWords) + w;
+		uint64_t previousCoop = (w > 0) ? coopCenter[i - 1] >> 63 : 0;
+		uint64_t nextCoop = (w + 1 < rowWords) ? coopCenter[i + 1] << 63 : 0;
+		uint64_t previousDefect = (w > 0) ? defectCenter[i - 1] >> 63 : 0;
+		uint64_t nextDefect =
+				(w + 1 < rowWords) ? defectCenter[i + 1] << 63 : 0;
+
+		coopLeft[i] = (coopCenter[i] << 1) | previousCoop;
+		coopRight[i] = (coopCenter[i] >> 1) | nextCoop;
+		defectLeft[i] = (defectCenter[i] << 1) | previousDefect;
+		defectRight[i] = (defectCenter[i] >> 1) | nextDefect;
+	}
+}
+
+void PayoffPlanes::countRow(std::vector<uint64_t>& _left,
+		std::vector<uint64_t>& _center, std::vector<uint64_t>& _right,
+		int _row, std::vector<uint64_t>& _count) {
+	const uint64_t* planes[8];
+	int numPlanes = 0;
+
+	// von Neumann
+	planes[numPlanes++] = &_center[(_row - 1) * rowWords];
+	planes[numPlanes++] = &_center[(_row + 1) * rowWords];
+	planes[numPlanes++] = &_left[_row * rowWords];
+	planes[numPlanes++] = &_right[_row * rowWords];
+
+	// Moore
+	if (moore) {
+		planes[numPlanes++] = &_left[(_row - 1) * rowWords];
+		planes[numPlanes++] = &_right[(_row - 1) * rowWords];
+		planes[numPlanes++] = &_left[(_row + 1) * rowWords];
+		planes[numPlanes++] = &_right[(_row + 1) * rowWords];
+	}
+
+	// Bit-sliced 4 bit counters, one full adder chain per plane
+	for (int w = 0; w < rowWords; w += LANE_WORDS) {
+		Lane bit0 = laneZero();
+		Lane bit1 = laneZero();
+		Lane bit2 = laneZero();
+		Lane bit3 = laneZero();
+
+		for (int p = 0; p < numPlanes; p++) {
+			Lane carry = laneLoad(planes[p] + w);
+			Lane next = laneAnd(bit0, carry);
+			bit0 = laneXor(bit0, carry);
+			carry = next;
+			next = laneAnd(bit1, carry);
+			bit1 = laneXor(bit1, carry);
+			carry = next;
+			next = laneAnd(bit2, carry);
+			bit2 = laneXor(bit2, carry);
+			bit3 = laneOr(bit3, next);
+		}
+
+		laneStore(&_count[w], bit0);
+		laneStore(&_count[rowWords + w], bit1);
+		laneStore(&_count[(2 * rowWords) + w], bit2);
+		laneStore(&_count[(3 * rowWords) + w], bit3);
+	}
+}
+
+void PayoffPlanes::calculatePayoff(AgentStore& _store, int _payoffT,
+		int _payoffR, int _payoffP, int _payoffS) {
+	int offsets[8] = { -frameWidth, frameWidth, -1, 1, -frameWidth - 1,
+			-frameWidth + 1, frameWidth - 1, frameWidth + 1 };
+	int numOffsets = moore ? 8 : 4;
+
+#pragma omp parallel for schedule(static)
+	for (int r = 0; r < frameHeight; r++) {
+		packRow(_store, r);
+	}
+
+#pragma omp parallel
+	{
+		// Bit-sliced neighbors' counts of a row, 4 bits per cell
+		std::vector<uint64_t> coopCount(4 * rowWords, 0);
+		std::vector<uint64_t> defectCount(4 * rowWords, 0);
+
+#pragma omp for schedule(static)
+		for (int r = 1; r <= height; r++) {
+			countRow(coopLeft, coopCenter, coopRight, r, coopCount);
+			countRow(defectLeft, defectCenter, defectRight, r, defectCount);
+
+			for (int c = 1; c <= width; c++) {
+				int f = (r * frameWidth) + c;
+				int i = frame[f];
+				int w = c >> 6;
+				int b = c & 63;
+
+				int numCooperate = 0;
+				int numDefect = 0;
+				for (int k = 0; k < 4; k++) {
+					numCooperate |= (int) ((coopCount[(k * rowWords) + w] >> b) & 1)
+							<< k;
+					numDefect |= (int) ((defectCount[(k * rowWords) + w] >> b) & 1)
+							<< k;
+				}
+
+				int status = _store.status[i];
+				int coalition = (status & (STATUS_LEADER | STATUS_MEMBER)) != 0;
+				int independent = (!coalition)
+						& ((status & STATUS_INDEPENDENT) != 0);
+				int cooperated = _store.action[i] == COOPERATE;
+				int defected = _store.action[i] == DEFECT;
+
+				// Neighbors in the same coalition are counted apart
+				int numMember = 0;
+				if (coalition) {
+					long long own = leaderFrame[f];
+					int cooperateSame = 0;
+					int defectSame = 0;
+
+					for (int k = 0; k < numOffsets; k++) {
+						int g = f + offsets[k];
+						int same = validFrame[g] & (leaderFrame[g] == own);
+						int action = _store.action[frame[g] < 0 ? i : frame[g]];
+						numMember += same;
+						cooperateSame += same & (action == COOPERATE);
+						defectSame += same & (action == DEFECT);
+					}
+
+					numCooperate -= cooperateSame;
+					numDefect -= defectSame;
+				}
+
+				// Payoff matrix: coalition {R, T, P}, cooperated {-, R, S} and
+				// defected {-, T, P} for members, cooperators and defectors
+				int memberCoef = coalition * _payoffR;
+				int cooperateCoef = (coalition * _payoffT)
+						+ (independent
+								* ((cooperated * _payoffR) + (defected * _payoffT)));
+				int defectCoef = (coalition * _payoffP)
+						+ (independent
+								* ((cooperated * _payoffS) + (defected * _payoffP)));
+				int counted = coalition | (independent & (cooperated | defected));
+
+				double value = (numMember * memberCoef)
+						+ (numCooperate * cooperateCoef) + (numDefect * defectCoef);
+				value = counted ? value : _store.payoff[i];
+				numDefect = counted ? numDefect : 0;
+
+				int numNeighbors = _store.neighborBegin[i + 1]
+						- _store.neighborBegin[i];
+				value = value / (float) numNeighbors;
+				if ((value != _store.payoff[i])
+						|| (numDefect != _store.numDefectors[i])) {
+					_store.payoff[i] = value;
+					_store.numDefectors[i] = numDefect;
+					_store.changed[i] |= CHANGED_PAYOFF;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef  __PAYOFFPLANES_H__
+#define  __PAYOFFPLANES_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "agentStore.h"
+
+/**
+ * Payoff kernel over bit-packed action planes. Each frame row (the local
+ * tile plus a ring of ghost cells) is packed into cooperate/defect bit
+ * planes, the neighbors' counts of a whole row are added with bit-sliced
+ * adders (AVX2/AVX-512 when available) and the payoff matrix is applied
+ * without branches. Results match AgentStore::calculatePayoff.
+ */
+class PayoffPlanes {
+
+private:
+	// Frame of (width + 2) x (height + 2) cells, store slot or -1
+	int width;
+	int height;
+	int frameWidth;
+	int frameHeight;
+	int rowWords;
+	bool moore;
+	std::vector<int> frame;
+
+	// Bit planes per frame row, shifted so that bit c holds the cell at
+	// column c - 1 (left), c (center) and c + 1 (right)
+	std::vector<uint64_t> coopLeft;
+	std::vector<uint64_t> coopCenter;
+	std::vector<uint64_t> coopRight;
+	std::vector<uint64_t> defectLeft;
+	std::vector<uint64_t> defectCenter;
+	std::vector<uint64_t> defectRight;
+
+	// Leader keys and validity of the frame cells
+	std::vector<long long> leaderFrame;
+	std::vector<char> validFrame;
+
+	void packRow(const AgentStore& _store, int _row);
+	void countRow(std::vector<uint64_t>& _left,
+			std::vector<uint64_t>& _center, std::vector<uint64_t>& _right,
+			int _row, std::vector<uint64_t>& _count);
+
+public:
+	PayoffPlanes();
+	~PayoffPlanes();
+
+	/**
+	 * Lays out the frame, _frame holds the store slot of each frame cell
+	 * (row major, -1 outside the world)
+	 */
+	void build(int _width, int _height, bool _moore,
+			const std::vector<int>& _frame);
+
+	/**
+	 * Local agents calculate their payoff based on their neighbors' actions
+	 */
+	void calculatePayoff(AgentStore& _store, int _payoffT, int _payoffR,
+			int _payoffP, int _payoffS);
+};
+
+#endif // __PAYOFFPLANES_H__
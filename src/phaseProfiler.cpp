@@ -0,0 +1,107 @@
+#include "phaseProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "commCounters.h"
+
+const char* PhaseProfiler::NAMES[NUM_PHASES] = { "setup", "decideAction",
+		"exchange", "payoff", "leaderPayoff", "syncPayoff", "decideCoalition",
+		"syncCoalition", "coalitionIndex", "coalitionStatus", "barrier",
+		"record", "write", "checkpoint", "snapshot" };
+
+PhaseProfiler::PhaseProfiler() {
+	enabled = false;
+	current = -1;
+	counters = 0;
+	tracer = 0;
+	for (int p = 0; p < NUM_PHASES; p++) {
+		started[p] = 0;
+		totals[p] = 0;
+		calls[p] = 0;
+		parent[p] = -1;
+	}
+}
+
+PhaseProfiler::~PhaseProfiler() {
+}
+
+void PhaseProfiler::enable(bool _enabled) {
+	enabled = _enabled;
+}
+
+bool PhaseProfiler::isEnabled() const {
+	return enabled;
+}
+
+void PhaseProfiler::setCounters(CommCounters* _counters) {
+	counters = _counters;
+}
+
+void PhaseProfiler::setTracer(PhaseTracer* _tracer) {
+	tracer = _tracer;
+}
+
+void PhaseProfiler::enter(int _phase) {
+	current = _phase;
+	if (counters != 0) {
+		counters->setPhase((current >= 0) ? current : PHASE_OTHER);
+	}
+}
+
+std::string PhaseProfiler::report(MPI_Comm _world,
+		const std::string& _file) const {
+	int rank = 0;
+	int size = 0;
+	MPI_Comm_rank(_world, &rank);
+	MPI_Comm_size(_world, &size);
+
+	std::vector<double> allTotals(rank == 0 ? NUM_PHASES * size : 1);
+	std::vector<long> allCalls(rank == 0 ? NUM_PHASES * size : 1);
+	MPI_Gather(const_cast<double*>(totals), NUM_PHASES, MPI_DOUBLE,
+			&allTotals[0], NUM_PHASES, MPI_DOUBLE, 0, _world);
+	MPI_Gather(const_cast<long*>(calls), NUM_PHASES, MPI_LONG, &allCalls[0],
+			NUM_PHASES, MPI_LONG, 0, _world);
+
+	if (rank != 0) {
+		return "";
+	}
+
+	std::ofstream out(_file.c_str(), std::ios::trunc);
+	out << "phase;rank;calls;seconds" << std::endl;
+	for (int p = 0; p < NUM_PHASES; p++) {
+		for (int r = 0; r < size; r++) {
+			out << NAMES[p] << ";" << r << ";"
+					<< allCalls[(r * NUM_PHASES) + p] << ";"
+					<< allTotals[(r * NUM_PHASES) + p] << std::endl;
+		}
+	}
+
+	// Imbalance is how much longer the slowest process took than the mean
+	std::ostringstream summary;
+	summary << "phase;calls;min;max;mean;imbalance";
+	for (int p = 0; p < NUM_PHASES; p++) {
+		double min = allTotals[p];
+		double max = allTotals[p];
+		double sum = 0;
+		long maxCalls = 0;
+		for (int r = 0; r < size; r++) {
+			double total = allTotals[(r * NUM_PHASES) + p];
+			min = std::min(min, total);
+			max = std::max(max, total);
+			sum += total;
+			maxCalls = std::max(maxCalls, allCalls[(r * NUM_PHASES) + p]);
+		}
+
+		if (maxCalls == 0) {
+			continue;
+		}
+
+		double mean = sum / size;
+		summary << "\n" << NAMES[p] << ";" << maxCalls << ";" << min << ";"
+				<< max << ";" << mean << ";"
+				<< ((mean > 0) ? (max / mean) - 1 : 0);
+	}
+	return summary.str();
+}
@@ -0,0 +1,100 @@
+#ifndef  __PHASEPROFILER_H__
+#define  __PHASEPROFILER_H__
+
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+#include "phaseTracer.h"
+
+class CommCounters;
+
+// Phases of the model
+const int PHASE_SETUP = 0;
+const int PHASE_DECIDE_ACTION = 1;
+const int PHASE_EXCHANGE = 2;
+const int PHASE_PAYOFF = 3;
+const int PHASE_LEADER_PAYOFF = 4;
+const int PHASE_SYNC_PAYOFF = 5;
+const int PHASE_DECIDE_COALITION = 6;
+const int PHASE_SYNC_COALITION = 7;
+const int PHASE_COALITION_INDEX = 8;
+const int PHASE_COALITION_STATUS = 9;
+const int PHASE_BARRIER = 10;
+const int PHASE_RECORD = 11;
+const int PHASE_WRITE = 12;
+const int PHASE_CHECKPOINT = 13;
+const int PHASE_SNAPSHOT = 14;
+const int NUM_PHASES = 15;
+
+/**
+ * Wall clock time and calls of each phase. Phases of different kinds may
+ * nest, a phase may not nest in itself. While disabled begin and end only
+ * test a flag. The innermost phase is passed on to the communication
+ * counters and every phase to the tracer, if any.
+ */
+class PhaseProfiler {
+
+private:
+	bool enabled;
+	double started[NUM_PHASES];
+	double totals[NUM_PHASES];
+	long calls[NUM_PHASES];
+
+	// Innermost phase and the phase each one was started in, -1 if none
+	int current;
+	int parent[NUM_PHASES];
+	CommCounters* counters;
+	PhaseTracer* tracer;
+
+	void enter(int _phase);
+
+public:
+	static const char* NAMES[NUM_PHASES];
+
+	PhaseProfiler();
+	~PhaseProfiler();
+
+	void enable(bool _enabled);
+	bool isEnabled() const;
+
+	/**
+	 * Counters told about every phase change
+	 */
+	void setCounters(CommCounters* _counters);
+
+	/**
+	 * Tracer given every phase
+	 */
+	void setTracer(PhaseTracer* _tracer);
+
+	inline void begin(int _phase) {
+		if (enabled) {
+			parent[_phase] = current;
+			enter(_phase);
+			started[_phase] = MPI_Wtime();
+		}
+	}
+
+	inline void end(int _phase) {
+		if (enabled) {
+			double now = MPI_Wtime();
+			totals[_phase] += now - started[_phase];
+			calls[_phase]++;
+			if (tracer != 0) {
+				tracer->add(_phase, started[_phase], now);
+			}
+			enter(parent[_phase]);
+		}
+	}
+
+	/**
+	 * Collective, gathers every process' totals on the first process, which
+	 * writes them to the file (phase, rank, calls, seconds) and returns the
+	 * min/max/mean/imbalance summary of each phase
+	 */
+	std::string report(MPI_Comm _world, const std::string& _file) const;
+};
+
+#endif // __PHASEPROFILER_H__
@@ -0,0 +1,102 @@
+#include "phaseTracer.h"
+
+#include <cstdio>
+
+PhaseTracer::PhaseTracer() {
+	interval = 0;
+	sampling = false;
+	tick = 0;
+	origin = 0;
+	next = 0;
+	wrapped = false;
+}
+
+PhaseTracer::~PhaseTracer() {
+}
+
+void PhaseTracer::start(MPI_Comm _world, int _interval, int _capacity) {
+	interval = _interval;
+	events.resize(_capacity > 0 ? _capacity : 1);
+	next = 0;
+	wrapped = false;
+
+	// The clocks of the processes may not be synchronized, the trace starts
+	// when all of them leave the barrier
+	MPI_Barrier(_world);
+	origin = MPI_Wtime();
+
+	setTick(tick);
+}
+
+bool PhaseTracer::isStarted() const {
+	return interval > 0;
+}
+
+void PhaseTracer::setTick(int _tick) {
+	tick = _tick;
+	sampling = (interval > 0) && ((tick % interval) == 0);
+}
+
+bool PhaseTracer::write(MPI_Comm _world, const std::string& _file,
+		const char** _names) const {
+	int rank = 0;
+	int size = 0;
+	MPI_Comm_rank(_world, &rank);
+	MPI_Comm_size(_world, &size);
+
+	// Complete events in microseconds, one process per rank, oldest first.
+	// Every process formats its own events, nothing is gathered.
+	std::string text;
+	char line[256];
+	if (rank == 0) {
+		text += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	}
+	std::snprintf(line, sizeof(line),
+			"%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+					"\"args\":{\"name\":\"rank %d\"}}", rank == 0 ? "" : ",",
+			rank, rank);
+	text += line;
+
+	size_t first = wrapped ? next : 0;
+	size_t count = wrapped ? events.size() : next;
+	for (size_t e = 0; e < count; e++) {
+		const TraceEvent& event = events[(first + e) % events.size()];
+		std::snprintf(line, sizeof(line),
+				",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":0,"
+						"\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"tick\":%d}}",
+				_names[event.phase], rank, event.start * 1e6,
+				event.duration * 1e6, event.tick);
+		text += line;
+	}
+	if (rank == size - 1) {
+		text += "\n]}\n";
+	}
+
+	// Processes follow each other in rank order
+	long long bytes = text.size();
+	long long offset = 0;
+	MPI_Exscan(&bytes, &offset, 1, MPI_LONG_LONG, MPI_SUM, _world);
+	if (rank == 0) {
+		offset = 0;
+	}
+
+	MPI_File file;
+	int opened = MPI_File_open(_world, const_cast<char*>(_file.c_str()),
+			MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+	if (opened != MPI_SUCCESS) {
+		return false;
+	}
+
+	// Shorter than a file left by an earlier run
+	MPI_File_set_size(file, 0);
+
+	MPI_Status status;
+	int ok = MPI_File_write_at_all(file, offset, &text[0], text.size(),
+			MPI_CHAR, &status) == MPI_SUCCESS;
+
+	MPI_File_close(&file);
+
+	int written = 0;
+	MPI_Allreduce(&ok, &written, 1, MPI_INT, MPI_MIN, _world);
+	return written != 0;
+}
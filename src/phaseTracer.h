@@ -0,0 +1,80 @@
+#ifndef  __PHASETRACER_H__
+#define  __PHASETRACER_H__
+
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+/**
+ * Phase of a sampled tick, seconds since the start of the trace
+ */
+struct TraceEvent {
+	double start;
+	double duration;
+	int tick;
+	int phase;
+};
+
+/**
+ * Timeline of the phases of every interval-th tick. Each process keeps its
+ * latest events in a ring buffer, the first process merges them into a
+ * Chrome trace (one track per process) that the trace viewers of Chrome
+ * and Perfetto load.
+ */
+class PhaseTracer {
+
+private:
+	int interval;
+	bool sampling;
+	int tick;
+	double origin;
+
+	// Ring buffer, next is the slot of the next event
+	std::vector<TraceEvent> events;
+	size_t next;
+	bool wrapped;
+
+public:
+	PhaseTracer();
+	~PhaseTracer();
+
+	/**
+	 * Collective, starts the clock of the trace on every process at once.
+	 * The latest capacity events are kept.
+	 */
+	void start(MPI_Comm _world, int _interval, int _capacity);
+
+	bool isStarted() const;
+
+	/**
+	 * Tick of the events that follow, sampled if a multiple of the interval
+	 */
+	void setTick(int _tick);
+
+	inline void add(int _phase, double _start, double _end) {
+		if (sampling) {
+			TraceEvent& event = events[next];
+			event.start = _start - origin;
+			event.duration = _end - _start;
+			event.tick = tick;
+			event.phase = _phase;
+
+			next++;
+			if (next == events.size()) {
+				next = 0;
+				wrapped = true;
+			}
+		}
+	}
+
+	/**
+	 * Collective, every process writes its events into the trace at its own
+	 * offset, with the phases named by names. Returns false if the file
+	 * could not be written.
+	 */
+	bool write(MPI_Comm _world, const std::string& _file,
+			const char** _names) const;
+};
+
+#endif // __PHASETRACER_H__
@@ -0,0 +1,116 @@
+#include "snapshotWriter.h"
+
+#include <cstring>
+#include <sstream>
+
+#include <zlib.h>
+
+SnapshotWriter::SnapshotWriter() {
+	world = MPI_COMM_NULL;
+	sizeX = 0;
+	sizeY = 0;
+	deflate = 0;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+}
+
+void SnapshotWriter::setup(MPI_Comm _world, const std::string& _directory,
+		const std::string& _task, int _sizeX, int _sizeY, int _deflate) {
+	world = _world;
+	directory = _directory;
+	task = _task;
+	sizeX = _sizeX;
+	sizeY = _sizeY;
+	deflate = _deflate;
+}
+
+std::string SnapshotWriter::fileName(int _round) const {
+	std::ostringstream name;
+	name << directory << "/snapshot" << task << "_" << _round << ".bin";
+	return name.str();
+}
+
+bool SnapshotWriter::write(int _round, int _originX, int _originY,
+		int _width, int _height, const std::vector<unsigned char>& _action,
+		const std::vector<unsigned char>& _status,
+		const std::vector<long long>& _leader,
+		const std::vector<double>& _payoff) {
+	int rank = 0;
+	int size = 0;
+	MPI_Comm_rank(world, &rank);
+	MPI_Comm_size(world, &size);
+
+	// Planes one after the other
+	size_t cells = _width * _height;
+	std::vector<unsigned char> raw(cells * (2 + sizeof(long long)
+			+ sizeof(double)) + 1);
+	unsigned char* plane = &raw[0];
+	if (cells > 0) {
+		std::memcpy(plane, &_action[0], cells);
+		plane += cells;
+		std::memcpy(plane, &_status[0], cells);
+		plane += cells;
+		std::memcpy(plane, &_leader[0], cells * sizeof(long long));
+		plane += cells * sizeof(long long);
+		std::memcpy(plane, &_payoff[0], cells * sizeof(double));
+		plane += cells * sizeof(double);
+	}
+	uLong rawBytes = plane - &raw[0];
+
+	std::vector<unsigned char> packed;
+	const unsigned char* data = &raw[0];
+	uLongf bytes = rawBytes;
+	int ok = 1;
+	if (deflate > 0) {
+		bytes = compressBound(rawBytes);
+		packed.resize(bytes + 1);
+		ok = compress2(&packed[0], &bytes, &raw[0], rawBytes, deflate)
+				== Z_OK;
+		data = &packed[0];
+	}
+
+	// Tiles follow the entries in rank order
+	long long tileBytes = bytes;
+	long long before = 0;
+	MPI_Exscan(&tileBytes, &before, 1, MPI_LONG_LONG, MPI_SUM, world);
+	if (rank == 0) {
+		before = 0;
+	}
+
+	long long offset = (long long) (sizeof(SnapshotHeader)
+			+ (size * sizeof(SnapshotTile))) + before;
+	SnapshotTile tile = { offset, tileBytes, (long long) rawBytes, _originX,
+			_originY, _width, _height };
+
+	MPI_File file;
+	std::string name = fileName(_round);
+	int opened = MPI_File_open(world, const_cast<char*>(name.c_str()),
+			MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+	if (opened != MPI_SUCCESS) {
+		return false;
+	}
+
+	// Shorter than a file left by an earlier run
+	MPI_File_set_size(file, 0);
+
+	MPI_Status status;
+	if (rank == 0) {
+		SnapshotHeader header = { MAGIC, VERSION, _round, sizeX, sizeY, size,
+				deflate, 0 };
+		ok &= MPI_File_write_at(file, 0, &header, sizeof(SnapshotHeader),
+				MPI_BYTE, &status) == MPI_SUCCESS;
+	}
+
+	ok &= MPI_File_write_at_all(file,
+			sizeof(SnapshotHeader) + (rank * sizeof(SnapshotTile)), &tile,
+			sizeof(SnapshotTile), MPI_BYTE, &status) == MPI_SUCCESS;
+	ok &= MPI_File_write_at_all(file, tile.offset, (void*) data, bytes,
+			MPI_BYTE, &status) == MPI_SUCCESS;
+
+	MPI_File_close(&file);
+
+	int written = 0;
+	MPI_Allreduce(&ok, &written, 1, MPI_INT, MPI_MIN, world);
+	return written != 0;
+}
@@ -0,0 +1,82 @@
+#ifndef  __SNAPSHOTWRITER_H__
+#define  __SNAPSHOTWRITER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+/**
+ * Header of a snapshot file, followed by one tile entry per process and the
+ * tiles' data
+ */
+struct SnapshotHeader {
+	uint32_t magic;
+	uint32_t version;
+	int round;
+	int sizeX;
+	int sizeY;
+	int numTiles;
+	int deflate;
+	int unused;
+};
+
+/**
+ * Tile of a process. Its data holds, row by row, the action and status
+ * (one byte per cell), the leader key and the payoff (eight bytes per
+ * cell) planes, deflated unless the level is 0.
+ */
+struct SnapshotTile {
+	long long offset;
+	long long bytes;
+	long long rawBytes;
+	int originX;
+	int originY;
+	int width;
+	int height;
+};
+
+/**
+ * Writes the grid of a round into a single file. Every process writes its
+ * tile entry and its data at their own offset, nothing goes through a
+ * single process.
+ */
+class SnapshotWriter {
+
+private:
+	MPI_Comm world;
+	std::string directory;
+	std::string task;
+	int sizeX;
+	int sizeY;
+	int deflate;
+
+public:
+	static const uint32_t MAGIC = 0x50414e53; // "SNAP"
+	static const uint32_t VERSION = 1;
+
+	SnapshotWriter();
+	~SnapshotWriter();
+
+	/**
+	 * Deflate level 0 writes the planes uncompressed. Tasks of an ensemble
+	 * share the directory, each one names its files with its task suffix.
+	 */
+	void setup(MPI_Comm _world, const std::string& _directory,
+			const std::string& _task, int _sizeX, int _sizeY, int _deflate);
+
+	std::string fileName(int _round) const;
+
+	/**
+	 * Collective, planes hold the tile row by row. Returns false if the
+	 * file could not be written.
+	 */
+	bool write(int _round, int _originX, int _originY, int _width,
+			int _height, const std::vector<unsigned char>& _action,
+			const std::vector<unsigned char>& _status,
+			const std::vector<long long>& _leader,
+			const std::vector<double>& _payoff);
+};
+
+#endif // __SNAPSHOTWRITER_H__
@@ -0,0 +1,32 @@
+#include "taskQueue.h"
+
+TaskQueue::TaskQueue(MPI_Comm _comm, int _size) {
+	int rank = 0;
+	MPI_Comm_rank(_comm, &rank);
+
+	size = _size;
+	counter = 0;
+
+	// Only the first process exposes the counter
+	MPI_Aint bytes = (rank == 0) ? sizeof(int) : 0;
+	MPI_Alloc_mem(sizeof(int), MPI_INFO_NULL, &counter);
+	*counter = 0;
+	MPI_Win_create(counter, bytes, sizeof(int), MPI_INFO_NULL, _comm,
+			&window);
+}
+
+TaskQueue::~TaskQueue() {
+	MPI_Win_free(&window);
+	MPI_Free_mem(counter);
+}
+
+int TaskQueue::next() {
+	int one = 1;
+	int task = 0;
+
+	MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, window);
+	MPI_Fetch_and_op(&one, &task, MPI_INT, 0, 0, MPI_SUM, window);
+	MPI_Win_unlock(0, window);
+
+	return (task < size) ? task : -1;
+}
@@ -0,0 +1,35 @@
+#ifndef  __TASKQUEUE_H__
+#define  __TASKQUEUE_H__
+
+#include <mpi.h>
+
+/**
+ * Shared queue of task indices [0, size). The next index is a counter on
+ * the first process taken with an atomic fetch and add, so whoever finishes
+ * first picks up the next task without a dispatcher process.
+ */
+class TaskQueue {
+
+private:
+	MPI_Win window;
+	int* counter;
+	int size;
+
+public:
+	/**
+	 * Collective over the communicator
+	 */
+	TaskQueue(MPI_Comm _comm, int _size);
+
+	/**
+	 * Collective over the communicator
+	 */
+	~TaskQueue();
+
+	/**
+	 * Takes the next task, -1 once the queue is exhausted
+	 */
+	int next();
+};
+
+#endif // __TASKQUEUE_H__
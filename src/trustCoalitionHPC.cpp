@@ -1,9 +1,13 @@
+#include <cstdio>
+#include <fstream>
 #include <iostream>
-#include <time.h>
 
 #include "landAgent.h"
 #include "landModel.h"
+#include "parameterSweep.h"
+#include "taskQueue.h"
 
+#include <repast_hpc/Properties.h>
 #include <repast_hpc/RepastProcess.h>
 #include <repast_hpc/Schedule.h>
 
@@ -34,6 +38,181 @@ void runLandModel(const std::string propsFile, int argc, char* argv[],
 	repast::ScheduleRunner& runner =
 			repast::RepastProcess::instance()->getScheduleRunner();
 	runner.run();
+
+	delete landModel;
+}
+
+std::string sweepSuffix(int _point, int _replicate) {
+	return "_p" + boost::lexical_cast<std::string>(_point) + "_r"
+			+ boost::lexical_cast<std::string>(_replicate);
+}
+
+/**
+ * Merges the outputs of a sweep into the output file, each row prefixed by
+ * its point, replicate and swept values
+ */
+void mergeSweep(const std::string& _file, const std::string& _separator,
+		const ParameterSweep& _sweep, int _replicates) {
+	std::ofstream out(_file.c_str());
+	bool header = true;
+
+	for (int p = 0, points = _sweep.numPoints(); p < points; p++) {
+		std::vector<std::pair<std::string, std::string> > values =
+				_sweep.point(p);
+		std::string prefix = boost::lexical_cast<std::string>(p);
+		for (int k = 0, size = values.size(); k < size; k++) {
+			prefix += _separator + values[k].second;
+		}
+
+		for (int r = 0; r < _replicates; r++) {
+			std::string file = LandModel::suffixFile(_file, sweepSuffix(p, r));
+			std::ifstream in(file.c_str());
+			std::string line;
+
+			if (!std::getline(in, line)) {
+				std::cerr << "sweep: missing output " << file << std::endl;
+				continue;
+			}
+
+			if (header) {
+				out << "point";
+				for (int k = 0, size = values.size(); k < size; k++) {
+					out << _separator << values[k].first;
+				}
+				out << _separator << "replicate" << _separator << line
+						<< std::endl;
+				header = false;
+			}
+
+			std::string replicate = boost::lexical_cast<std::string>(r);
+			while (std::getline(in, line)) {
+				if (!line.empty()) {
+					out << prefix << _separator << replicate << _separator
+							<< line << std::endl;
+				}
+			}
+			in.close();
+			std::remove(file.c_str());
+		}
+	}
+}
+
+/**
+ * Runs the (parameter point, replicate) tasks of an ensemble or a sweep,
+ * each group of processes takes the next task from a shared queue when it
+ * finishes the previous one, so slow and fast points balance out
+ */
+void runEnsemble(const std::string config, const std::string propsFile,
+		int argc, char* argv[], boost::mpi::communicator* world,
+		repast::Properties& props, const ParameterSweep& sweep) {
+	int replicates = std::max(1,
+			repast::strToInt(props.getProperty(ENSEMBLE_REPLICATES)));
+	int points = sweep.numPoints();
+	int groupSize = repast::strToInt(props.getProperty(PROC_X))
+			* repast::strToInt(props.getProperty(PROC_Y));
+	int numGroups = world->size() / groupSize;
+	int group = world->rank() / groupSize;
+
+	if ((world->rank() == 0) && ((numGroups * groupSize) != world->size())) {
+		std::cerr << "ensemble: " << (world->size() - (numGroups * groupSize))
+				<< " processes left idle, the number of processes is not a"
+				<< " multiple of " << groupSize << std::endl;
+	}
+
+	// Processes beyond the last full group stay idle
+	boost::mpi::communicator groupWorld = world->split(
+			(group < numGroups) ? group : numGroups);
+
+	{
+		TaskQueue queue(*world, points * replicates);
+
+		int seed = repast::strToInt(props.getProperty(RANDOM_SEED));
+		// Files written by every task
+		std::vector<std::string> fileKeys;
+		fileKeys.push_back(OUTPUT_FILE);
+		fileKeys.push_back(PROFILE_FILE);
+		fileKeys.push_back(PROFILE_COMM_FILE);
+		fileKeys.push_back(PROFILE_TRAFFIC);
+		fileKeys.push_back(TRACE_FILE);
+
+		while (group < numGroups) {
+			int task = 0;
+			if (groupWorld.rank() == 0) {
+				task = queue.next();
+			}
+			boost::mpi::broadcast(groupWorld, task, 0);
+
+			if (task < 0) {
+				break;
+			}
+
+			int point = task / replicates;
+			int replicate = task % replicates;
+
+			// Task properties override the properties file, replicates of
+			// every point share their seeds
+			std::vector<std::string> args(argv, argv + argc);
+			std::vector<std::pair<std::string, std::string> > values =
+					sweep.point(point);
+			for (int k = 0, size = values.size(); k < size; k++) {
+				args.push_back(values[k].first + "=" + values[k].second);
+			}
+			args.push_back(
+					RANDOM_SEED + "="
+							+ boost::lexical_cast<std::string>(
+									seed + replicate));
+
+			std::string suffix = "_"
+					+ boost::lexical_cast<std::string>(replicate);
+			if (!sweep.empty()) {
+				suffix = sweepSuffix(point, replicate);
+			}
+			args.push_back(ENSEMBLE_TASK + "=" + suffix);
+			for (int k = 0, size = fileKeys.size(); k < size; k++) {
+				args.push_back(
+						fileKeys[k] + "="
+								+ LandModel::suffixFile(
+										props.getProperty(fileKeys[k]),
+										suffix));
+			}
+
+			std::vector<char*> taskArgv;
+			for (int a = 0, size = args.size(); a < size; a++) {
+				taskArgv.push_back(&args[a][0]);
+			}
+
+			repast::RepastProcess::init(config, &groupWorld);
+			double start = MPI_Wtime();
+
+			runLandModel(propsFile, taskArgv.size(), &taskArgv[0],
+					&groupWorld);
+			groupWorld.barrier();
+
+			double end = MPI_Wtime();
+			if (groupWorld.rank() == 0) {
+				Log4CL::instance()->get_logger("root").log(INFO,
+						"point " + boost::lexical_cast<std::string>(point)
+								+ " replicate "
+								+ boost::lexical_cast<std::string>(replicate)
+								+ " on group "
+								+ boost::lexical_cast<std::string>(group)
+								+ ", time: "
+								+ boost::lexical_cast<std::string>(
+										end - start));
+			}
+			repast::RepastProcess::instance()->done();
+		}
+	}
+
+	// NetCDF outputs stay one file per task
+	if ((!sweep.empty())
+			&& (repast::strToInt(props.getProperty(OUTPUT_FORMAT)) == CSV)) {
+		world->barrier();
+		if (world->rank() == 0) {
+			mergeSweep(props.getProperty(OUTPUT_FILE),
+					props.getProperty(OUTPUT_SEPARATOR), sweep, replicates);
+		}
+	}
 }
 
 int main(int argc, char* argv[]) {
@@ -43,14 +222,46 @@ int main(int argc, char* argv[]) {
 		return -1;
 	}
 
-	boost::mpi::environment env(argc, argv);
+	// The OpenMP kernels and the output writer thread run beside the main
+	// thread, which makes every MPI call
+	boost::mpi::environment env(argc, argv,
+			boost::mpi::threading::funneled);
 	boost::mpi::communicator world;
 
+	if (env.thread_level() < boost::mpi::threading::funneled) {
+		if (world.rank() == 0) {
+			std::cerr << "The MPI library does not support threads, "
+					<< "MPI_THREAD_FUNNELED is required" << std::endl;
+		}
+		env.abort(-1);
+	}
+
 	std::string config = argv[1];
 	std::string props = argv[2];
 
+	repast::Properties modelProps(props, argc, argv, &world);
+
+	ParameterSweep sweep;
+	for (repast::Properties::key_iterator key = modelProps.keys_begin();
+			key != modelProps.keys_end(); ++key) {
+		std::string name = *key;
+		if (name.compare(0, SWEEP_PREFIX.size(), SWEEP_PREFIX) == 0) {
+			sweep.add(name.substr(SWEEP_PREFIX.size()),
+					modelProps.getProperty(name));
+		}
+	}
+
+	if ((!sweep.empty())
+			|| (repast::strToInt(modelProps.getProperty(ENSEMBLE_REPLICATES))
+					> 0)) {
+		runEnsemble(config, props, argc, argv, &world, modelProps, sweep);
+		world.barrier();
+		return 0;
+	}
+
 	repast::RepastProcess::init(config, &world);
-	clock_t start = clock();
+	// Wall clock, the processor time would add up the threads
+	double start = MPI_Wtime();
 
 	// Runs the model
 	runLandModel(props, argc, argv, &world);
@@ -58,13 +269,11 @@ int main(int argc, char* argv[]) {
 	// Wait for all the processes to finish the execution
 	world.barrier();
 
-	clock_t end = clock();
+	double end = MPI_Wtime();
 	if (world.rank() == 0) {
-		long double diff = end - start;
 		Log4CL::instance()->get_logger("root").log(INFO,
 				"total execution, time: "
-						+ boost::lexical_cast<std::string>(
-								diff / CLOCKS_PER_SEC));
+						+ boost::lexical_cast<std::string>(end - start));
 	}
 	repast::RepastProcess::instance()->done();
 	return 0;
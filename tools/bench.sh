@@ -0,0 +1,203 @@
+#!/bin/bash
+#
+# Weak and strong scaling of the model, von Neumann and Moore neighborhoods
+# on a grid and on a torus, run from the tools directory.
+#
+# usage: bench.sh [-b] [-c] [key=value ...]
+#
+#   -b          stores the results as the baseline
+#   -c          compares the results with the baseline
+#   key=value   properties of every run (e.g. model.store=1)
+#
+# Environment:
+#   BENCH_PROCS        process counts (powers of 2 up to the cores)
+#   BENCH_ROUNDS       rounds of every run (10)
+#   BENCH_WEAK_SIDE    cells per process side of the weak scaling (256)
+#   BENCH_STRONG_SIDE  grid side of the strong scaling (4096)
+#   BENCH_MPIRUN       MPI launcher (mpirun)
+#
+# Process counts are split into the most square decomposition, wider
+# along x (2 = 2x1, 8 = 4x2), so the tiles of the strong scaling are not
+# square for odd powers of 2; the model lays out any tile shape.
+#
+# Runs replicate only the buffer cells (model.replication=1), full
+# replication would put every agent of the grid on every process. The
+# replication, store and exchange of the runs, from conf/model.props or
+# the key=value arguments, are columns of the results so that only runs
+# with the same settings are compared.
+#
+# One line per run in ../output/bench.csv: rounds per second and agent
+# updates per second exclude the setup, the phase columns are the seconds
+# of the slowest process. Failed runs are left out, listed at the end and
+# make the script exit with 1.
+
+BASELINE=../bench/baseline.csv
+RESULTS=../output/bench.csv
+RUNS=../output/bench
+
+STORE=0
+COMPARE=0
+while getopts "bc" option
+do
+  case $option in
+    b) STORE=1 ;;
+    c) COMPARE=1 ;;
+    *) echo "usage: bench.sh [-b] [-c] [key=value ...]"; exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+ROUNDS=${BENCH_ROUNDS:-10}
+WEAK_SIDE=${BENCH_WEAK_SIDE:-256}
+STRONG_SIDE=${BENCH_STRONG_SIDE:-4096}
+MPIRUN=${BENCH_MPIRUN:-mpirun}
+
+# Value of a key in conf/model.props
+setting() {
+  sed -n "s/^$1 *= *//p" ../conf/model.props | tail -1
+}
+
+# Settings of the runs, the key=value arguments override them as they do
+# in the model
+REPLICATION=1
+STORE_TYPE=$(setting "model\.store")
+EXCHANGE=$(setting "model\.exchange")
+for argument in "$@"
+do
+  case $argument in
+    model.replication=*) REPLICATION=${argument#*=} ;;
+    model.store=*) STORE_TYPE=${argument#*=} ;;
+    model.exchange=*) EXCHANGE=${argument#*=} ;;
+  esac
+done
+
+if [ -z "$BENCH_PROCS" ]
+then
+  CORES=$(nproc)
+  BENCH_PROCS=1
+  for ((p = 2; p <= CORES; p *= 2))
+  do
+    BENCH_PROCS="$BENCH_PROCS $p"
+  done
+fi
+
+# Most square decomposition, the wider side along x
+decompose() {
+  local y=1
+  for ((d = 1; d * d <= $1; d++))
+  do
+    if (($1 % d == 0))
+    then
+      y=$d
+    fi
+  done
+  echo "$(($1 / y)) $y"
+}
+
+mkdir -p $RUNS
+HEADER=""
+FAILED=""
+: > $RESULTS
+
+for mode in weak strong
+do
+  for neighborhood in 0 1
+  do
+    for topology in 0 1
+    do
+      for procs in $BENCH_PROCS
+      do
+        read procX procY <<< "$(decompose $procs)"
+        if [ $mode == weak ]
+        then
+          sizeX=$((procX * WEAK_SIDE))
+          sizeY=$((procY * WEAK_SIDE))
+        else
+          sizeX=$STRONG_SIDE
+          sizeY=$STRONG_SIDE
+        fi
+
+        run=${mode}_n${neighborhood}_t${topology}_p${procs}
+        echo "$run: ${sizeX}x${sizeY} cells on ${procX}x${procY} processes"
+
+        log=$($MPIRUN -np $procs ../bin/trustCoalitionHPC \
+            ../conf/config.props ../conf/model.props \
+            grid.max.x=$((sizeX - 1)) grid.max.y=$((sizeY - 1)) \
+            proc.per.x=$procX proc.per.y=$procY \
+            model.rounds=$ROUNDS model.neighborhood=$neighborhood \
+            model.topology=$topology model.replication=1 \
+            output.file=$RUNS/${run}_data.csv \
+            profile.enabled=1 profile.file=$RUNS/${run}_profile.csv \
+            "$@" 2>&1)
+        if [ $? -ne 0 ]
+        then
+          echo "$log" > $RUNS/${run}.log
+          echo "$run failed, see $RUNS/${run}.log"
+          FAILED="$FAILED $run"
+          continue
+        fi
+
+        total=$(echo "$log" | grep -o "total execution, time: [0-9.e+-]*" \
+            | tail -1 | awk '{print $4}')
+
+        # Seconds of the slowest process of each phase
+        phases=$(awk -F";" 'NR > 1 {
+              if (!($1 in max)) { order[n++] = $1 }
+              if ($4 > max[$1]) { max[$1] = $4 }
+            }
+            END {
+              for (i = 0; i < n; i++) {
+                names = names ";" order[i]; values = values ";" max[order[i]]
+              }
+              print substr(names, 2) "|" substr(values, 2)
+            }' $RUNS/${run}_profile.csv)
+
+        if [ -z "$HEADER" ]
+        then
+          HEADER="mode;neighborhood;topology;replication;store;exchange"
+          HEADER="$HEADER;processes;sizeX;sizeY;rounds"
+          HEADER="$HEADER;seconds;roundsPerSecond;updatesPerSecond"
+          HEADER="$HEADER;${phases%%|*}"
+          echo "$HEADER" >> $RESULTS
+        fi
+
+        awk -v mode=$mode -v n=$neighborhood -v t=$topology \
+            -v settings="$REPLICATION;$STORE_TYPE;$EXCHANGE" -v p=$procs \
+            -v x=$sizeX -v y=$sizeY -v r=$ROUNDS -v total=$total \
+            -v phases="${phases%%|*}" -v values="${phases##*|}" 'BEGIN {
+              split(phases, name, ";")
+              count = split(values, value, ";")
+              for (i = 1; i <= count; i++) {
+                if (name[i] == "setup") { setup = value[i] }
+              }
+              steps = total - setup
+              rate = (steps > 0) ? r / steps : 0
+              printf "%s;%d;%d;%s;%d;%d;%d;%d;%s;%g;%g;%s\n", mode, n, t,
+                  settings, p, x, y, r, total, rate, rate * x * y, values
+            }' >> $RESULTS
+      done
+    done
+  done
+done
+
+echo "Results in $RESULTS"
+
+STATUS=0
+if [ -n "$FAILED" ]
+then
+  echo "Failed runs:$FAILED"
+  STATUS=1
+fi
+
+if [ $STORE -eq 1 ]
+then
+  cp $RESULTS $BASELINE
+  echo "Baseline stored in $BASELINE"
+fi
+
+if [ $COMPARE -eq 1 ]
+then
+  ./benchCompare.sh $RESULTS $BASELINE || STATUS=1
+fi
+
+exit $STATUS
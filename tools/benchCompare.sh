@@ -0,0 +1,59 @@
+#!/bin/bash
+#
+# Compares the rounds per second of two bench.sh result files, runs slower
+# than the baseline by more than the tolerance are flagged as regressions.
+# Runs are matched by mode, neighborhood, topology, replication, store,
+# exchange and processes, runs without a match are left out.
+#
+# usage: benchCompare.sh <results> <baseline> [tolerance (0.1)]
+#
+# Exits with 1 if any run regressed.
+
+if [ $# -lt 2 ]
+then
+  echo
+  echo "usage: benchCompare.sh <results> <baseline> [tolerance]"
+  echo
+  exit 1
+fi
+
+if [ ! -f $2 ]
+then
+  echo "No baseline $2, store one with bench.sh -b"
+  exit 0
+fi
+
+KEYS="mode;neighborhood;topology;replication;store;exchange;processes"
+echo "$KEYS;baseline;current;change;"
+awk -F";" -v keys=$KEYS -v tolerance=${3:-0.1} '
+  BEGIN { count = split(keys, names, ";") }
+  FNR == 1 {
+    delete column
+    for (c = 1; c <= NF; c++) { column[$c] = c }
+    next
+  }
+  {
+    key = ""
+    for (k = 1; k <= count; k++) {
+      key = key (k > 1 ? ";" : "") ((names[k] in column) ? \
+          $column[names[k]] : "")
+    }
+  }
+  FILENAME == ARGV[1] {
+    baseline[key] = $column["roundsPerSecond"]
+    next
+  }
+  {
+    if (!(key in baseline) || (baseline[key] <= 0)) { next }
+
+    change = ($column["roundsPerSecond"] / baseline[key]) - 1
+    flag = ""
+    if (change < -tolerance) {
+      flag = "REGRESSION"
+      regressions++
+    }
+    printf "%s;%g;%g;%+.1f%%;%s\n", key, baseline[key],
+        $column["roundsPerSecond"], change * 100, flag
+  }
+  END { exit (regressions > 0) ? 1 : 0 }
+' $2 $1
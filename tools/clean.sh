@@ -3,3 +3,7 @@
 rm ../logs/*.log
 rm ../logs/.l*
 rm ../output/*.csv
+rm ../checkpoint/*.bin
+rm ../checkpoint/latest*
+rm ../snapshot/*.bin
+rm -r ../output/bench